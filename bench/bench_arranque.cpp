@@ -0,0 +1,181 @@
+// bench/bench_arranque.cpp
+// Latencia de arranque: tiempo y fallos de página menores desde que el
+// programa empieza hasta tener la primera imagen decodificada, en modo
+// convencional (stb con malloc), con un pool de 256 MB construido de
+// antemano (el antiguo global estático) y con el pool perezoso dimensionado
+// desde la cabecera de la imagen (stbi_info), como hace Parcial2_Danna.
+// El último modo arranca con la caché caliente: se adjunta a un pool
+// persistente (BuddyOpciones::archivoPersistente) donde una ejecución
+// anterior publicó los píxeles, y los copia sin decodificar.
+// Cada modo se repite y se informa la mediana.
+//
+// Uso: ./bench_arranque [imagen] [repeticiones]
+
+#include "buddy_allocator.h"
+#include "stb_image.h"
+#include "stb_wrapper.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <sys/resource.h>
+#include <unistd.h>
+#include <vector>
+
+using Reloj = std::chrono::steady_clock;
+
+static const size_t POOL_FIJO = 256 * 1024 * 1024;
+static const size_t POOL_MINIMO = 4 * 1024 * 1024;
+static const char* const ARCHIVO_CACHE = "bench_arranque.cache";
+static const size_t TAM_CACHE = 64 * 1024 * 1024;
+
+struct Medida {
+    double msPool;     // Construir el pool (0 en modo convencional)
+    double msImagen;   // Hasta tener la imagen decodificada
+    long fallos;       // Fallos de página menores en todo el arranque
+};
+
+static long fallosMenores() {
+    rusage uso;
+    getrusage(RUSAGE_SELF, &uso);
+    return uso.ru_minflt;
+}
+
+static BuddyOpciones opcionesPool() {
+    BuddyOpciones opciones;
+    opciones.marcaDiferida = 4;
+    opciones.compuestos = true;
+    return opciones;
+}
+
+static BuddyOpciones opcionesCache() {
+    BuddyOpciones opciones;
+    opciones.compuestos = true;
+    opciones.archivoPersistente = ARCHIVO_CACHE;
+    return opciones;
+}
+
+// Ejecución "anterior": decodifica la imagen y la deja en la caché
+static bool calentarCache(const char* ruta) {
+    unlink(ARCHIVO_CACHE);
+    int ancho, alto, canales;
+    unsigned char* pixeles = stbi_load(ruta, &ancho, &alto, &canales, 0);
+    if (!pixeles) return false;
+    BuddyAllocator cache(TAM_CACHE, opcionesCache());
+    size_t tam = static_cast<size_t>(ancho) * alto * canales;
+    void* copia = cache.alloc(tam);
+    const uint32_t datos[4] = {uint32_t(ancho), uint32_t(alto), uint32_t(canales), 0};
+    bool ok = copia != nullptr;
+    if (ok) {
+        std::memcpy(copia, pixeles, tam);
+        ok = cache.publicarEnIndice(ruta, copia, datos);
+    }
+    stbi_image_free(pixeles);
+    return ok;
+}
+
+// Con la caché caliente el pool de trabajo se dimensiona igual que el perezoso
+static bool arrancarCache(const char* ruta, Medida& m) {
+    long f0 = fallosMenores();
+    auto t0 = Reloj::now();
+
+    BuddyAllocator pool(std::max(stbHuellaPrevista(ruta, 2), POOL_MINIMO), opcionesPool());
+    BuddyAllocator cache(TAM_CACHE, opcionesCache());
+    auto t1 = Reloj::now();
+
+    BuddyAllocator::EntradaIndice entrada;
+    void* guardada = cache.buscarEnIndice(ruta, &entrada);
+    if (!guardada) return false;
+    size_t tam = static_cast<size_t>(entrada.datos[0]) * entrada.datos[1] * entrada.datos[2];
+    void* pixeles = pool.allocAligned(tam, ImageAllocator::ALINEACION_MAXIMA);
+    if (!pixeles) return false;
+    std::memcpy(pixeles, guardada, tam);
+    auto t2 = Reloj::now();
+    m.fallos = fallosMenores() - f0;
+    m.msPool = std::chrono::duration<double, std::milli>(t1 - t0).count();
+    m.msImagen = std::chrono::duration<double, std::milli>(t2 - t0).count();
+
+    pool.free(pixeles);
+    return true;
+}
+
+// tamPool: 0 = convencional; SIZE_MAX = perezoso (según stbi_info);
+// 1 = caché caliente
+static bool arrancar(const char* ruta, size_t tamPool, Medida& m) {
+    if (tamPool == 1) return arrancarCache(ruta, m);
+
+    long f0 = fallosMenores();
+    auto t0 = Reloj::now();
+
+    std::unique_ptr<BuddyAllocator> pool;
+    if (tamPool == SIZE_MAX) {
+        tamPool = std::max(stbHuellaPrevista(ruta, 2), POOL_MINIMO);
+    }
+    if (tamPool) pool.reset(new BuddyAllocator(tamPool, opcionesPool()));
+    auto t1 = Reloj::now();
+
+    int ancho, alto, canales;
+    unsigned char* pixeles;
+    {
+        StbAmbitoPool ambito(pool.get());
+        pixeles = stbi_load(ruta, &ancho, &alto, &canales, 0);
+    }
+    auto t2 = Reloj::now();
+    m.fallos = fallosMenores() - f0;
+    m.msPool = std::chrono::duration<double, std::milli>(t1 - t0).count();
+    m.msImagen = std::chrono::duration<double, std::milli>(t2 - t0).count();
+
+    if (!pixeles) return false;
+    if (pool) pool->free(pixeles);
+    else stbi_image_free(pixeles);
+    return true;
+}
+
+static void medir(const char* nombre, const char* ruta, size_t tamPool, int repeticiones) {
+    std::vector<double> pool, imagen;
+    std::vector<long> fallos;
+    for (int i = 0; i < repeticiones; ++i) {
+        Medida m;
+        if (!arrancar(ruta, tamPool, m)) {
+            std::printf("%-16s no se pudo decodificar '%s'\n", nombre, ruta);
+            return;
+        }
+        pool.push_back(m.msPool);
+        imagen.push_back(m.msImagen);
+        fallos.push_back(m.fallos);
+    }
+    std::sort(pool.begin(), pool.end());
+    std::sort(imagen.begin(), imagen.end());
+    std::sort(fallos.begin(), fallos.end());
+    std::printf("%-16s %12.3f %14.3f %14ld\n", nombre, pool[pool.size() / 2],
+                imagen[imagen.size() / 2], fallos[fallos.size() / 2]);
+}
+
+int main(int argc, char* argv[]) {
+    const char* ruta = argc > 1 ? argv[1] : "../img/testImg01.jpg";
+    int repeticiones = argc > 2 ? std::atoi(argv[2]) : 20;
+
+    int ancho, alto, canales;
+    if (!stbi_info(ruta, &ancho, &alto, &canales)) {
+        std::fprintf(stderr, "Error: no se pudo leer la cabecera de '%s'\n", ruta);
+        return 1;
+    }
+    std::printf("Imagen '%s' %dx%dx%d, pool perezoso %.1f MB, %d repeticiones (mediana)\n",
+                ruta, ancho, alto, canales,
+                std::max(stbHuellaPrevista(ruta, 2), POOL_MINIMO) / (1024.0 * 1024.0),
+                repeticiones);
+    std::printf("%-16s %12s %14s %14s\n", "modo", "ms pool", "ms 1a imagen", "fallos menores");
+    medir("conv (malloc)", ruta, 0, repeticiones);
+    medir("buddy 256 MB", ruta, POOL_FIJO, repeticiones);
+    medir("buddy perezoso", ruta, SIZE_MAX, repeticiones);
+    if (calentarCache(ruta)) {
+        medir("cache caliente", ruta, 1, repeticiones);
+    } else {
+        std::printf("%-16s no se pudo preparar '%s'\n", "cache caliente", ARCHIVO_CACHE);
+    }
+    unlink(ARCHIVO_CACHE);
+    return 0;
+}
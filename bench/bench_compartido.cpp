@@ -0,0 +1,165 @@
+// bench/bench_compartido.cpp
+// Entrega de fotogramas decodificados de un proceso decodificador a un
+// proceso de transformación. Con el pool compartido (BuddyOpciones::
+// compartido) el decodificador deja cada fotograma en el segmento y sólo
+// envía por la tubería su desplazamiento; el transformador lo lee en su
+// propio mapeo y lo libera. La alternativa es enviar los píxeles por la
+// tubería, que los copia dos veces (al núcleo y del núcleo). Se informa el
+// tiempo por fotograma, desde que el decodificador lo tiene hasta que el
+// transformador ha recorrido sus píxeles.
+
+#include "buddy_allocator.h"
+#include "stb_image.h"
+#include "stb_wrapper.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+using Reloj = std::chrono::steady_clock;
+
+struct Fotograma {
+    uint64_t desplazamiento;   // En el pool compartido (o SIN_DESPLAZAMIENTO si va por la tubería)
+    int ancho, alto, canales;
+};
+
+static bool leerTodo(int fd, void* destino, size_t n) {
+    char* p = static_cast<char*>(destino);
+    while (n) {
+        ssize_t r = read(fd, p, n);
+        if (r <= 0) return false;
+        p += r;
+        n -= r;
+    }
+    return true;
+}
+
+static bool escribirTodo(int fd, const void* origen, size_t n) {
+    const char* p = static_cast<const char*>(origen);
+    while (n) {
+        ssize_t r = write(fd, p, n);
+        if (r <= 0) return false;
+        p += r;
+        n -= r;
+    }
+    return true;
+}
+
+// "Transformación" mínima: recorrer los píxeles, para que el coste de traer
+// el fotograma a la caché del transformador cuente en los dos modos
+static uint64_t sumar(const unsigned char* p, size_t n) {
+    uint64_t s = 0;
+    for (size_t i = 0; i < n; i += 64) s += p[i];
+    return s;
+}
+
+// El decodificador decodifica una vez en el pool (stb_image reserva en él) y
+// después copia esa imagen en un bloque nuevo por fotograma, como si
+// decodificara cada uno.
+static void decodificador(BuddyAllocator* pool, const char* ruta, int fotogramas, int salida, int ack) {
+    int ancho, alto, canales;
+    unsigned char* original;
+    {
+        StbAmbitoPool ambito(pool);
+        original = stbi_load(ruta, &ancho, &alto, &canales, 0);
+    }
+    if (!original) _exit(1);
+    size_t tam = static_cast<size_t>(ancho) * alto * canales;
+
+    for (int i = 0; i < fotogramas; ++i) {
+        Fotograma f{BuddyAllocator::SIN_DESPLAZAMIENTO, ancho, alto, canales};
+        if (pool) {
+            void* bloque = pool->alloc(tam);
+            if (!bloque) _exit(1);
+            std::memcpy(bloque, original, tam);
+            f.desplazamiento = pool->desplazamientoDe(bloque);
+            escribirTodo(salida, &f, sizeof(f));
+        } else {
+            escribirTodo(salida, &f, sizeof(f));
+            escribirTodo(salida, original, tam);
+        }
+        char c;
+        if (!leerTodo(ack, &c, 1)) _exit(1);  // Un fotograma en vuelo
+    }
+    if (pool) pool->free(original);
+    else stbi_image_free(original);
+    _exit(0);
+}
+
+static double medir(const char* ruta, int fotogramas, bool compartido, uint64_t& suma) {
+    BuddyAllocator* pool = nullptr;
+    if (compartido) {
+        BuddyOpciones opciones;
+        opciones.compartido = true;  // memfd; el hijo lo hereda con fork
+        opciones.compuestos = true;
+        pool = new BuddyAllocator(256 * 1024 * 1024, opciones);
+    }
+
+    int datos[2], ack[2];
+    if (pipe(datos) != 0 || pipe(ack) != 0) return -1;
+    pid_t hijo = fork();
+    if (hijo == 0) {
+        close(datos[0]);
+        close(ack[1]);
+        decodificador(pool, ruta, fotogramas, datos[1], ack[0]);
+    }
+    close(datos[1]);
+    close(ack[0]);
+
+    std::vector<unsigned char> recibido;
+    double total = 0;
+    suma = 0;
+    for (int i = 0; i < fotogramas; ++i) {
+        Fotograma f;
+        if (!leerTodo(datos[0], &f, sizeof(f))) break;
+        auto t0 = Reloj::now();
+        size_t tam = static_cast<size_t>(f.ancho) * f.alto * f.canales;
+        if (compartido) {
+            unsigned char* p = static_cast<unsigned char*>(pool->punteroDe(f.desplazamiento));
+            suma += sumar(p, tam);
+            pool->free(p);
+        } else {
+            recibido.resize(tam);
+            leerTodo(datos[0], recibido.data(), tam);
+            suma += sumar(recibido.data(), tam);
+        }
+        total += std::chrono::duration<double, std::milli>(Reloj::now() - t0).count();
+        escribirTodo(ack[1], "k", 1);
+    }
+    close(datos[0]);
+    close(ack[1]);
+    int estado;
+    waitpid(hijo, &estado, 0);
+    delete pool;
+    if (!WIFEXITED(estado) || WEXITSTATUS(estado) != 0) return -1;
+    return total / fotogramas;
+}
+
+int main(int argc, char* argv[]) {
+    const char* ruta = argc > 1 ? argv[1] : "../img/testImg01.jpg";
+    int fotogramas = argc > 2 ? std::atoi(argv[2]) : 200;
+
+    int ancho, alto, canales;
+    if (!stbi_info(ruta, &ancho, &alto, &canales)) {
+        std::fprintf(stderr, "No se pudo leer '%s'\n", ruta);
+        return 1;
+    }
+    double mb = double(ancho) * alto * canales / (1024.0 * 1024.0);
+    std::printf("Fotogramas %dx%dx%d (%.1f MB), %d fotogramas\n", ancho, alto, canales, mb, fotogramas);
+    std::printf("%-12s %14s %12s\n", "entrega", "ms/fotograma", "MB/s");
+
+    uint64_t sumaTubo, sumaCompartido;
+    double tubo = medir(ruta, fotogramas, false, sumaTubo);
+    double compartido = medir(ruta, fotogramas, true, sumaCompartido);
+    if (tubo < 0 || compartido < 0) {
+        std::fprintf(stderr, "El proceso decodificador falló\n");
+        return 1;
+    }
+    std::printf("%-12s %14.3f %12.0f\n", "tuberia", tubo, mb / (tubo / 1000.0));
+    std::printf("%-12s %14.3f %12.0f\n", "compartido", compartido, mb / (compartido / 1000.0));
+    if (sumaTubo != sumaCompartido) std::printf("  aviso: los fotogramas recibidos no coinciden\n");
+    return 0;
+}
@@ -0,0 +1,96 @@
+// bench/bench_contencion.cpp
+// Contención entre hilos: de 1 a N hilos reservan y liberan bloques del tamaño
+// de teselas de imagen (32x32 a 256x256 píxeles). Se compara el modo
+// concurrente del BuddyAllocator (cargadores por hilo) contra el mismo
+// allocator protegido por un cerrojo global y contra malloc/free.
+
+#include "buddy_allocator.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+using Reloj = std::chrono::steady_clock;
+
+static const size_t POOL = 256 * 1024 * 1024;
+static const int VIVOS_POR_HILO = 32;
+
+// Tamaños de tesela: ancho x alto x canales
+static const size_t TESELAS[] = {
+    32 * 32 * 3, 64 * 64 * 3, 64 * 64 * 4, 128 * 128 * 3, 256 * 256 * 3
+};
+
+struct ConCerrojo {
+    BuddyAllocator buddy{POOL};
+    std::mutex m;
+    void* alloc(size_t t) { std::lock_guard<std::mutex> g(m); return buddy.alloc(t); }
+    void free(void* p) { std::lock_guard<std::mutex> g(m); buddy.free(p); }
+    void fin() {}
+};
+
+struct Concurrente {
+    BuddyAllocator buddy{POOL, [] { BuddyOpciones o; o.concurrente = true; return o; }()};
+    void* alloc(size_t t) { return buddy.alloc(t); }
+    void free(void* p) { buddy.free(p); }
+    void fin() { buddy.vaciarCacheHilo(); }
+};
+
+struct Malloc {
+    void* alloc(size_t t) { return std::malloc(t); }
+    void free(void* p) { std::free(p); }
+    void fin() {}
+};
+
+template <typename Backend>
+void trabajador(Backend& b, int semilla, int operaciones) {
+    std::mt19937 rng(semilla);
+    std::uniform_int_distribution<int> tam(0, sizeof(TESELAS) / sizeof(TESELAS[0]) - 1);
+    std::uniform_int_distribution<int> cual(0, VIVOS_POR_HILO - 1);
+
+    void* vivos[VIVOS_POR_HILO];
+    for (auto& v : vivos) v = b.alloc(TESELAS[tam(rng)]);
+
+    for (int i = 0; i < operaciones; ++i) {
+        int k = cual(rng);
+        b.free(vivos[k]);
+        vivos[k] = b.alloc(TESELAS[tam(rng)]);
+        // Tocar la tesela como lo haría un kernel de imagen
+        if (vivos[k]) static_cast<unsigned char*>(vivos[k])[0] = static_cast<unsigned char>(i);
+    }
+
+    for (auto v : vivos) b.free(v);
+    b.fin();
+}
+
+// Devuelve millones de operaciones (alloc + free) por segundo
+template <typename Backend>
+double medir(int hilos, int operaciones) {
+    Backend b;
+    std::vector<std::thread> ts;
+    auto t0 = Reloj::now();
+    for (int h = 0; h < hilos; ++h) {
+        ts.emplace_back([&b, h, operaciones] { trabajador(b, 100 + h, operaciones); });
+    }
+    for (auto& t : ts) t.join();
+    auto t1 = Reloj::now();
+    double seg = std::chrono::duration<double>(t1 - t0).count();
+    return 2.0 * hilos * operaciones / seg / 1e6;
+}
+
+int main(int argc, char* argv[]) {
+    int maxHilos = argc > 1 ? std::atoi(argv[1]) : std::max(4u, std::thread::hardware_concurrency());
+    int operaciones = argc > 2 ? std::atoi(argv[2]) : 200000;
+
+    std::printf("%-8s %16s %16s %16s   (Mops/s)\n", "hilos", "cerrojo global", "cargadores", "malloc");
+    for (int h = 1; h <= maxHilos; h *= 2) {
+        double g = medir<ConCerrojo>(h, operaciones);
+        double c = medir<Concurrente>(h, operaciones);
+        double m = medir<Malloc>(h, operaciones);
+        std::printf("%-8d %16.2f %16.2f %16.2f\n", h, g, c, m);
+    }
+    return 0;
+}
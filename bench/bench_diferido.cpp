@@ -0,0 +1,71 @@
+// bench/bench_diferido.cpp
+// Coste de alloc/free por imagen en régimen estacionario, con fusión
+// inmediata y con fusión diferida (BuddyOpciones::marcaDiferida).
+// Cada "imagen" reproduce las reservas de un lote de imágenes de la misma
+// resolución: temporales del decodificador, el buffer decodificado y el de
+// salida de la transformación. Con fusión inmediata cada imagen vuelve a
+// dividir y fusionar los mismos bloques grandes; con la diferida, tras la
+// primera imagen los bloques se reutilizan tal cual.
+
+#include "buddy_allocator.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+using Reloj = std::chrono::steady_clock;
+
+static const size_t POOL = 256 * 1024 * 1024;
+
+// Reservas de una imagen: los temporales se liberan tras decodificar y los
+// dos buffers de imagen al terminar
+static void procesarImagen(BuddyAllocator& a, size_t tamImagen) {
+    static const size_t temporales[] = {16384, 4096, 1280, 65536, 8192, 2048};
+    void* t[sizeof(temporales) / sizeof(temporales[0])];
+    for (size_t i = 0; i < sizeof(temporales) / sizeof(temporales[0]); ++i) {
+        t[i] = a.alloc(temporales[i]);
+    }
+    void* decodificada = a.alloc(tamImagen);
+    for (void* p : t) a.free(p);
+
+    void* salida = a.alloc(tamImagen);
+    a.free(decodificada);
+    a.free(salida);
+}
+
+static void medir(const char* nombre, size_t marca, size_t tamImagen, int imagenes) {
+    BuddyOpciones opciones;
+    opciones.marcaDiferida = marca;
+    BuddyAllocator a(POOL, opciones);
+
+    procesarImagen(a, tamImagen);  // Calentamiento: primera imagen del lote
+    BuddyEstadisticas antes = a.getStats();
+
+    auto t0 = Reloj::now();
+    for (int i = 0; i < imagenes; ++i) procesarImagen(a, tamImagen);
+    auto t1 = Reloj::now();
+
+    BuddyEstadisticas despues = a.getStats();
+    double ns = std::chrono::duration<double, std::nano>(t1 - t0).count() / imagenes;
+    std::printf("%-12s %14.1f %12.2f %12.2f\n", nombre, ns,
+                double(despues.splits - antes.splits) / imagenes,
+                double(despues.coalesces - antes.coalesces) / imagenes);
+
+    a.trim();
+    if (a.getStats().bloqueMaximoLibre != POOL) {
+        std::printf("  aviso: trim no reconstruyó el bloque completo\n");
+    }
+}
+
+int main(int argc, char* argv[]) {
+    int ancho = argc > 1 ? std::atoi(argv[1]) : 1920;
+    int alto = argc > 2 ? std::atoi(argv[2]) : 1080;
+    int imagenes = argc > 3 ? std::atoi(argv[3]) : 100000;
+    size_t tamImagen = static_cast<size_t>(ancho) * alto * 3;
+
+    std::printf("Imagen %dx%dx3 (%zu bytes), %d imágenes\n", ancho, alto, tamImagen, imagenes);
+    std::printf("%-12s %14s %12s %12s\n", "fusion", "ns/imagen", "splits/img", "coalesce/img");
+    medir("inmediata", 0, tamImagen, imagenes);
+    medir("diferida 4", 4, tamImagen, imagenes);
+    return 0;
+}
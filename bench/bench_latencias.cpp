@@ -0,0 +1,76 @@
+// bench/bench_latencias.cpp
+// Latencias de cola del núcleo: se enlaza con el motor compilado con
+// BUDDY_LATENCIAS (buddy_allocator_latencias.o) y reproduce una carga
+// mezclada de temporales pequeños y buffers de imagen, con frees en orden
+// aleatorio. Imprime p50/p99/max en ciclos de alloc, free, split y coalesce
+// por tamaño de bloque, con fusión inmediata y con fusión diferida.
+//
+// Uso: ./bench_latencias [operaciones] [bloques vivos]
+
+#include "buddy_allocator.h"
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+static const size_t POOL = 256 * 1024 * 1024;
+
+static void imprimir(const BuddyEstadisticas& e) {
+    std::printf("  %-9s %12s %10s %8s %8s %10s\n", "op", "bloque", "muestras", "p50", "p99", "max");
+    for (int op = 0; op < BuddyEstadisticas::NUM_OPERACIONES_LATENCIA; ++op) {
+        const BuddyEstadisticas::Latencia& t = e.latenciaTotal[op];
+        std::printf("  %-9s %12s %10llu %8llu %8llu %10llu\n", BuddyEstadisticas::nombreOperacion(op),
+                    "total", static_cast<unsigned long long>(t.muestras),
+                    static_cast<unsigned long long>(t.p50), static_cast<unsigned long long>(t.p99),
+                    static_cast<unsigned long long>(t.max));
+        for (int l = 0; l < BuddyEstadisticas::MAX_NIVELES; ++l) {
+            const BuddyEstadisticas::Latencia& n = e.latenciaPorNivel[op][l];
+            if (!n.muestras) continue;
+            std::printf("  %-9s %10zu B %10llu %8llu %8llu %10llu\n", "", e.tamMinBloque << l,
+                        static_cast<unsigned long long>(n.muestras),
+                        static_cast<unsigned long long>(n.p50), static_cast<unsigned long long>(n.p99),
+                        static_cast<unsigned long long>(n.max));
+        }
+    }
+}
+
+static void medir(const char* nombre, size_t marca, int operaciones, size_t vivos) {
+    BuddyOpciones opciones;
+    opciones.marcaDiferida = marca;
+    BuddyAllocator a(POOL, opciones);
+    std::mt19937 rng(42);
+    // Tamaños log-uniformes de 64 B a 4 MB: muchos temporales, pocos buffers grandes
+    std::uniform_int_distribution<int> exponente(6, 22);
+    std::vector<void*> bloques;
+    bloques.reserve(vivos);
+
+    for (int i = 0; i < operaciones; ++i) {
+        if (bloques.size() == vivos || (!bloques.empty() && rng() % 2)) {
+            size_t k = rng() % bloques.size();
+            a.free(bloques[k]);
+            bloques[k] = bloques.back();
+            bloques.pop_back();
+        } else {
+            size_t tam = (size_t(1) << exponente(rng)) + rng() % 512;
+            if (void* p = a.alloc(tam)) bloques.push_back(p);
+        }
+    }
+    for (void* p : bloques) a.free(p);
+
+    std::printf("%s:\n", nombre);
+    imprimir(a.getStats());
+}
+
+int main(int argc, char* argv[]) {
+    int operaciones = argc > 1 ? std::atoi(argv[1]) : 200000;
+    size_t vivos = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 64;
+
+    if (!BuddyAllocator::latenciasCompiladas()) {
+        std::fprintf(stderr, "Error: enlazar con buddy_allocator_latencias.o (BUDDY_LATENCIAS)\n");
+        return 1;
+    }
+    std::printf("%d operaciones, hasta %zu bloques vivos (latencias en ciclos)\n", operaciones, vivos);
+    medir("Fusión inmediata", 0, operaciones, vivos);
+    medir("Fusión diferida (marca 4)", 4, operaciones, vivos);
+    return 0;
+}
@@ -0,0 +1,80 @@
+// bench/bench_motor.cpp
+// Compara el motor de bitmaps (BuddyAllocator) contra la implementación
+// clásica (BuddyAllocatorClasico) con dos cargas:
+//  - mismo tamaño LIFO: un buffer de imagen que se reserva y libera en bucle
+//  - fragmentada: muchos bloques pequeños vivos reemplazados al azar, que
+//    alarga las listas libres y castiga el recorrido lineal de coalesce
+
+#include "buddy_allocator.h"
+#include "buddy_allocator_clasico.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+using Reloj = std::chrono::steady_clock;
+
+static const size_t POOL = 32 * 1024 * 1024;
+
+template <typename Allocator>
+double mismoTamano(Allocator& a, size_t tam, int iteraciones) {
+    auto t0 = Reloj::now();
+    for (int i = 0; i < iteraciones; ++i) {
+        void* p = a.alloc(tam);
+        a.free(p);
+    }
+    auto t1 = Reloj::now();
+    return std::chrono::duration<double, std::nano>(t1 - t0).count() / (2.0 * iteraciones);
+}
+
+template <typename Allocator>
+double fragmentada(Allocator& a, int vivos, int iteraciones) {
+    std::mt19937 rng(1234);
+    std::uniform_int_distribution<size_t> tam(64, 8192);
+    std::uniform_int_distribution<int> cual(0, vivos - 1);
+
+    std::vector<void*> bloques(vivos);
+    for (auto& b : bloques) b = a.alloc(tam(rng));
+
+    auto t0 = Reloj::now();
+    for (int i = 0; i < iteraciones; ++i) {
+        int k = cual(rng);
+        a.free(bloques[k]);
+        bloques[k] = a.alloc(tam(rng));
+    }
+    auto t1 = Reloj::now();
+
+    for (auto b : bloques) a.free(b);
+    return std::chrono::duration<double, std::nano>(t1 - t0).count() / (2.0 * iteraciones);
+}
+
+int main(int argc, char* argv[]) {
+    int iteraciones = argc > 1 ? std::atoi(argv[1]) : 200000;
+
+    std::printf("%-28s %14s %14s\n", "carga (ns/op)", "clasico", "bitmaps");
+
+    const size_t tamanos[] = {4096, 1024 * 1024, 12 * 1024 * 1024};
+    for (size_t t : tamanos) {
+        BuddyAllocatorClasico clasico(POOL);
+        BuddyAllocator bitmaps(POOL);
+        double c = mismoTamano(clasico, t, iteraciones);
+        double b = mismoTamano(bitmaps, t, iteraciones);
+        char nombre[64];
+        std::snprintf(nombre, sizeof(nombre), "mismo tamano %zu KB", t / 1024);
+        std::printf("%-28s %14.1f %14.1f\n", nombre, c, b);
+    }
+
+    const int vivos[] = {256, 1024};
+    for (int v : vivos) {
+        BuddyAllocatorClasico clasico(POOL);
+        BuddyAllocator bitmaps(POOL);
+        double c = fragmentada(clasico, v, iteraciones);
+        double b = fragmentada(bitmaps, v, iteraciones);
+        char nombre[64];
+        std::snprintf(nombre, sizeof(nombre), "fragmentada %d vivos", v);
+        std::printf("%-28s %14.1f %14.1f\n", nombre, c, b);
+    }
+
+    return 0;
+}
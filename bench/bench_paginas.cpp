@@ -0,0 +1,129 @@
+// bench/bench_paginas.cpp
+// Páginas grandes vs páginas de 4 KB para el bucle interno de rotación.
+// Se reservan en el pool el buffer de origen y el de destino de una imagen
+// grande (por defecto 6000x6000 RGB, ~108 MB cada uno) y se mide el tiempo de
+// rotarla y los fallos de dTLB con perf_event_open. Si el kernel no permite
+// leer contadores (perf_event_paranoid, contenedores) se muestra "n/d".
+
+#include "buddy_allocator.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+using Reloj = std::chrono::steady_clock;
+
+// Contador de fallos de lectura en la dTLB del proceso (sólo espacio de usuario)
+static int abrirContadorDtlb() {
+    perf_event_attr pe;
+    std::memset(&pe, 0, sizeof(pe));
+    pe.type = PERF_TYPE_HW_CACHE;
+    pe.size = sizeof(pe);
+    pe.config = PERF_COUNT_HW_CACHE_DTLB |
+                (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    pe.disabled = 1;
+    pe.exclude_kernel = 1;
+    pe.exclude_hv = 1;
+    return static_cast<int>(syscall(SYS_perf_event_open, &pe, 0, -1, -1, 0));
+}
+
+// Misma rotación con interpolación bilineal que ImagenOptimizada::rotar
+static void rotar(const unsigned char* src, unsigned char* dst, int ancho, int alto,
+                  int canales, int angulo) {
+    float rad = angulo * M_PI / 180.0f;
+    float cosA = std::cos(rad), sinA = std::sin(rad);
+    float cx = ancho / 2.0f, cy = alto / 2.0f;
+
+    for (int y = 0; y < alto; ++y) {
+        for (int x = 0; x < ancho; ++x) {
+            float xr = x - cx, yr = y - cy;
+            float xp = xr * cosA - yr * sinA + cx;
+            float yp = xr * sinA + yr * cosA + cy;
+            unsigned char* out = dst + (static_cast<size_t>(y) * ancho + x) * canales;
+            if (xp < 0 || xp >= ancho - 1 || yp < 0 || yp >= alto - 1) {
+                for (int c = 0; c < canales; ++c) out[c] = 0;
+                continue;
+            }
+            int x0 = static_cast<int>(xp), y0 = static_cast<int>(yp);
+            float dx = xp - x0, dy = yp - y0;
+            const unsigned char* p00 = src + (static_cast<size_t>(y0) * ancho + x0) * canales;
+            const unsigned char* p01 = p00 + static_cast<size_t>(ancho) * canales;
+            for (int c = 0; c < canales; ++c) {
+                float v = p00[c] * (1 - dx) * (1 - dy) + p00[canales + c] * dx * (1 - dy) +
+                          p01[c] * (1 - dx) * dy + p01[canales + c] * dx * dy;
+                out[c] = static_cast<unsigned char>(v);
+            }
+        }
+    }
+}
+
+static void medir(const char* nombre, const BuddyOpciones& opciones,
+                  int ancho, int alto, int canales, int angulo) {
+    size_t tam = static_cast<size_t>(ancho) * alto * canales;
+    BuddyAllocator pool(2 * tam, opciones);
+
+    auto* src = static_cast<unsigned char*>(pool.alloc(tam));
+    auto* dst = static_cast<unsigned char*>(pool.alloc(tam));
+    if (!src || !dst) {
+        std::printf("%-16s sin memoria en el pool\n", nombre);
+        return;
+    }
+    for (size_t i = 0; i < tam; ++i) src[i] = static_cast<unsigned char>(i * 31);
+    std::memset(dst, 0, tam);
+
+    int fd = abrirContadorDtlb();
+    if (fd >= 0) {
+        ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+    auto t0 = Reloj::now();
+    rotar(src, dst, ancho, alto, canales, angulo);
+    auto t1 = Reloj::now();
+
+    long long fallos = -1;
+    if (fd >= 0) {
+        ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        if (read(fd, &fallos, sizeof(fallos)) != sizeof(fallos)) fallos = -1;
+        close(fd);
+    }
+
+    double ms = std::chrono::duration<double, std::milli>(t1 - t0).count();
+    double mbps = tam / (1024.0 * 1024.0) / (ms / 1000.0);
+    char dtlb[32];
+    if (fallos >= 0) std::snprintf(dtlb, sizeof(dtlb), "%lld", fallos);
+    else std::snprintf(dtlb, sizeof(dtlb), "n/d");
+    std::printf("%-16s %-8s %4d %10.1f %12.1f %16s\n", nombre, pool.getRespaldo(),
+                pool.getNodoArena(), ms, mbps, dtlb);
+
+    pool.free(dst);
+    pool.free(src);
+}
+
+int main(int argc, char* argv[]) {
+    int ancho = argc > 1 ? std::atoi(argv[1]) : 6000;
+    int alto = argc > 2 ? std::atoi(argv[2]) : 6000;
+    int angulo = argc > 3 ? std::atoi(argv[3]) : 37;
+    const int canales = 3;
+
+    std::printf("Imagen %dx%dx%d, rotación %d grados\n", ancho, alto, canales, angulo);
+    std::printf("%-16s %-8s %4s %10s %12s %16s\n", "pool", "respaldo", "nodo", "ms", "MB/s",
+                "fallos dTLB");
+
+    BuddyOpciones normal;
+    medir("4 KB", normal, ancho, alto, canales, angulo);
+
+    BuddyOpciones grandes;
+    grandes.respaldo = RespaldoPool::PaginasGrandes;
+    medir("paginas grandes", grandes, ancho, alto, canales, angulo);
+
+    BuddyOpciones numa = grandes;
+    numa.numaLocal = true;
+    medir("grandes + NUMA", numa, ancho, alto, canales, angulo);
+    return 0;
+}
@@ -0,0 +1,150 @@
+// bench/bench_pipeline.cpp
+// Pipeline de 3 etapas, cada una en su hilo: "decodificar" reserva un
+// fotograma y lo rellena, "filtrar" reserva el de salida, lo calcula y libera
+// el de entrada, y "codificar" lo resume y lo libera. Ningún fotograma se
+// libera en el hilo que lo reservó. Se compara el BuddyAllocator con un
+// cerrojo global, su modo concurrente, BuddyPorHilo (pools por hilo con pila
+// de liberaciones remotas) y malloc/free.
+// Entre etapas hay colas de un productor y un consumidor sin cerrojos.
+//
+// Uso: ./bench_pipeline [fotogramas] [bytes por fotograma]
+
+#include "buddy_allocator.h"
+#include "buddy_por_hilo.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+
+using Reloj = std::chrono::steady_clock;
+
+static const size_t POOL = 64 * 1024 * 1024;
+static const size_t TAM_COLA = 64;
+static const size_t ZANCADA = 64;   // Las etapas tocan una línea de caché de cada 64 bytes
+
+struct ConCerrojo {
+    BuddyAllocator buddy{POOL};
+    std::mutex m;
+    void* alloc(size_t t) { std::lock_guard<std::mutex> g(m); return buddy.alloc(t); }
+    void free(void* p) { std::lock_guard<std::mutex> g(m); buddy.free(p); }
+    void fin() {}
+};
+
+struct Concurrente {
+    BuddyAllocator buddy{POOL, [] { BuddyOpciones o; o.concurrente = true; return o; }()};
+    void* alloc(size_t t) { return buddy.alloc(t); }
+    void free(void* p) { buddy.free(p); }
+    void fin() { buddy.vaciarCacheHilo(); }
+};
+
+struct PorHilo {
+    BuddyPorHilo buddy{POOL};
+    void* alloc(size_t t) { return buddy.alloc(t); }
+    void free(void* p) { buddy.free(p); }
+    void fin() {}
+};
+
+struct Malloc {
+    void* alloc(size_t t) { return std::malloc(t); }
+    void free(void* p) { std::free(p); }
+    void fin() {}
+};
+
+// Cola de un productor y un consumidor; espera cediendo la CPU
+class Cola {
+public:
+    void meter(unsigned char* f) {
+        size_t c = cola.load(std::memory_order_relaxed);
+        while (c - cabeza.load(std::memory_order_acquire) == TAM_COLA) std::this_thread::yield();
+        datos[c % TAM_COLA] = f;
+        cola.store(c + 1, std::memory_order_release);
+    }
+    unsigned char* sacar() {
+        size_t h = cabeza.load(std::memory_order_relaxed);
+        while (cola.load(std::memory_order_acquire) == h) std::this_thread::yield();
+        unsigned char* f = datos[h % TAM_COLA];
+        cabeza.store(h + 1, std::memory_order_release);
+        return f;
+    }
+
+private:
+    unsigned char* datos[TAM_COLA];
+    alignas(64) std::atomic<size_t> cabeza{0};
+    alignas(64) std::atomic<size_t> cola{0};
+};
+
+// Devuelve miles de fotogramas por segundo; nullptr en la cola = fin
+template <typename Backend>
+double medir(int fotogramas, size_t tam, uint64_t& resumen) {
+    Backend b;
+    Cola decodificados, filtrados;
+    std::atomic<int> fallos{0};
+    auto t0 = Reloj::now();
+
+    std::thread decodificar([&] {
+        for (int i = 0; i < fotogramas; ++i) {
+            unsigned char* f = static_cast<unsigned char*>(b.alloc(tam));
+            if (!f) {
+                fallos.fetch_add(1);
+                continue;
+            }
+            for (size_t k = 0; k < tam; k += ZANCADA) f[k] = static_cast<unsigned char>(i + k);
+            decodificados.meter(f);
+        }
+        decodificados.meter(nullptr);
+        b.fin();
+    });
+    std::thread filtrar([&] {
+        while (unsigned char* f = decodificados.sacar()) {
+            unsigned char* salida = static_cast<unsigned char*>(b.alloc(tam));
+            if (salida) {
+                for (size_t k = 0; k < tam; k += ZANCADA) salida[k] = f[k] ^ 0x5a;
+                filtrados.meter(salida);
+            } else {
+                fallos.fetch_add(1);
+            }
+            b.free(f);
+        }
+        filtrados.meter(nullptr);
+        b.fin();
+    });
+    std::thread codificar([&] {
+        uint64_t suma = 0;
+        while (unsigned char* f = filtrados.sacar()) {
+            for (size_t k = 0; k < tam; k += ZANCADA) suma += f[k];
+            b.free(f);
+        }
+        resumen = suma;
+        b.fin();
+    });
+    decodificar.join();
+    filtrar.join();
+    codificar.join();
+    auto t1 = Reloj::now();
+
+    if (fallos.load()) std::printf("  (%d reservas fallidas)\n", fallos.load());
+    double seg = std::chrono::duration<double>(t1 - t0).count();
+    return fotogramas / seg / 1e3;
+}
+
+int main(int argc, char* argv[]) {
+    int fotogramas = argc > 1 ? std::atoi(argv[1]) : 200000;
+    size_t tam = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 64 * 64 * 3;
+
+    std::printf("%d fotogramas de %zu bytes, %u CPU\n", fotogramas, tam,
+                std::thread::hardware_concurrency());
+    std::printf("%-16s %14s %20s\n", "allocator", "kfotogramas/s", "resumen");
+    uint64_t r;
+    double v;
+    v = medir<ConCerrojo>(fotogramas, tam, r);
+    std::printf("%-16s %14.1f %20llu\n", "cerrojo global", v, static_cast<unsigned long long>(r));
+    v = medir<Concurrente>(fotogramas, tam, r);
+    std::printf("%-16s %14.1f %20llu\n", "concurrente", v, static_cast<unsigned long long>(r));
+    v = medir<PorHilo>(fotogramas, tam, r);
+    std::printf("%-16s %14.1f %20llu\n", "pools por hilo", v, static_cast<unsigned long long>(r));
+    v = medir<Malloc>(fotogramas, tam, r);
+    std::printf("%-16s %14.1f %20llu\n", "malloc", v, static_cast<unsigned long long>(r));
+    return 0;
+}
@@ -0,0 +1,139 @@
+// bench/bench_slab.cpp
+// Reservas mixtas de una tubería de imágenes: por cada imagen, el buffer
+// decodificado y el de salida (grandes) conviven con muchos objetos pequeños
+// (descriptores por fila, por tesela de 64x64 y trabajos de 8 teselas). Se
+// compara el buddy sin slabs (cada objeto pequeño ocupa un bloque de 64 bytes
+// o más del árbol), con slabs (BuddyOpciones::slabs) y malloc. Se informa el
+// tiempo por imagen y cuántos bytes del pool ocupan de media los objetos
+// pequeños vivos.
+// Antes de medir comprueba que BuddyMemoryResource respeta alineaciones de
+// 16 a 64 bytes en objetos que caen en slabs (sólo alineados a 16).
+
+#include "buddy_allocator.h"
+#include "buddy_memory_resource.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+using Reloj = std::chrono::steady_clock;
+
+static const size_t POOL = 256 * 1024 * 1024;
+
+// Tamaños de los objetos pequeños (bytes): fila, tesela y trabajo
+static const size_t TAM_FILA = 24;
+static const size_t TAM_TESELA = 48;
+static const size_t TAM_TRABAJO = 160;
+
+struct Resultado {
+    double nsImagen;
+    double bytesPorObjeto;  // Huella en el pool de cada objeto pequeño (0 si no se mide)
+};
+
+// Reservas de una imagen. Si a es nullptr se usa malloc. huella recibe los
+// bytes en uso del pool con todos los objetos pequeños vivos menos los de
+// los dos buffers grandes.
+static int procesarImagen(BuddyAllocator* a, int ancho, int alto, size_t* huella) {
+    auto reservar = [a](size_t n) { return a ? a->alloc(n) : std::malloc(n); };
+    auto liberar = [a](void* p) { a ? a->free(p) : std::free(p); };
+
+    size_t tamImagen = static_cast<size_t>(ancho) * alto * 3;
+    void* decodificada = reservar(tamImagen);
+    size_t conImagen = huella && a ? a->getStats().bytesEnUso : 0;
+
+    std::vector<void*> filas(alto), teselas, trabajos;
+    for (int y = 0; y < alto; ++y) filas[y] = reservar(TAM_FILA);
+    for (int ty = 0; ty < alto; ty += 64) {
+        for (int tx = 0; tx < ancho; tx += 64) {
+            teselas.push_back(reservar(TAM_TESELA));
+            if (teselas.size() % 8 == 0) trabajos.push_back(reservar(TAM_TRABAJO));
+        }
+    }
+    if (huella && a) *huella = a->getStats().bytesEnUso - conImagen;
+
+    // Las filas se sueltan al terminar de decodificar; las teselas y los
+    // trabajos, intercalados, a medida que se procesan
+    for (void* p : filas) liberar(p);
+    void* salida = reservar(tamImagen);
+    for (size_t i = 0; i < teselas.size(); ++i) {
+        liberar(teselas[i]);
+        if (i % 8 == 7) liberar(trabajos[i / 8]);
+    }
+    for (size_t i = teselas.size() / 8; i < trabajos.size(); ++i) liberar(trabajos[i]);
+    liberar(decodificada);
+    liberar(salida);
+    return static_cast<int>(filas.size() + teselas.size() + trabajos.size());
+}
+
+static Resultado medir(BuddyAllocator* a, int ancho, int alto, int imagenes) {
+    size_t huella = 0;
+    int objetos = procesarImagen(a, ancho, alto, &huella);  // Calentamiento
+
+    auto t0 = Reloj::now();
+    for (int i = 0; i < imagenes; ++i) procesarImagen(a, ancho, alto, nullptr);
+    auto t1 = Reloj::now();
+
+    Resultado r;
+    r.nsImagen = std::chrono::duration<double, std::nano>(t1 - t0).count() / imagenes;
+    r.bytesPorObjeto = a ? double(huella) / objetos : 0.0;
+    return r;
+}
+
+static void imprimir(const char* nombre, const Resultado& r, int objetos) {
+    if (r.bytesPorObjeto > 0) {
+        std::printf("%-14s %14.1f %12.1f %16.1f\n", nombre, r.nsImagen, r.nsImagen / objetos,
+                    r.bytesPorObjeto);
+    } else {
+        std::printf("%-14s %14.1f %12.1f %16s\n", nombre, r.nsImagen, r.nsImagen / objetos, "-");
+    }
+}
+
+// Objetos pequeños con alineaciones de 16, 32 y 64 bytes por el adaptador pmr
+static bool comprobarAlineacion() {
+    BuddyOpciones opciones;
+    opciones.slabs = true;
+    BuddyAllocator a(POOL, opciones);
+    BuddyMemoryResource recurso(a);
+    bool bien = true;
+    for (size_t alineacion = 16; alineacion <= 64; alineacion *= 2) {
+        void* p[20];
+        for (void*& q : p) {
+            q = recurso.allocate(48, alineacion);
+            if (reinterpret_cast<uintptr_t>(q) % alineacion != 0) {
+                std::printf("Error: allocate(48, %zu) devolvió %p\n", alineacion, q);
+                bien = false;
+            }
+        }
+        for (void* q : p) recurso.deallocate(q, 48, alineacion);
+    }
+    return bien;
+}
+
+int main(int argc, char* argv[]) {
+    int ancho = argc > 1 ? std::atoi(argv[1]) : 1920;
+    int alto = argc > 2 ? std::atoi(argv[2]) : 1080;
+    int imagenes = argc > 3 ? std::atoi(argv[3]) : 2000;
+
+    if (!comprobarAlineacion()) return 1;
+
+    int teselas = ((ancho + 63) / 64) * ((alto + 63) / 64);
+    int objetos = alto + teselas + teselas / 8;
+    std::printf("Imagen %dx%dx3, %d objetos pequeños por imagen (%zu/%zu/%zu B), %d imágenes\n",
+                ancho, alto, objetos, TAM_FILA, TAM_TESELA, TAM_TRABAJO, imagenes);
+    std::printf("%-14s %14s %12s %16s\n", "allocator", "ns/imagen", "ns/objeto", "B pool/objeto");
+
+    BuddyOpciones opciones;
+    opciones.compuestos = true;
+    {
+        BuddyAllocator a(POOL, opciones);
+        imprimir("buddy", medir(&a, ancho, alto, imagenes), objetos);
+    }
+    opciones.slabs = true;
+    {
+        BuddyAllocator a(POOL, opciones);
+        imprimir("buddy+slabs", medir(&a, ancho, alto, imagenes), objetos);
+    }
+    imprimir("malloc", medir(nullptr, ancho, alto, imagenes), objetos);
+    return 0;
+}
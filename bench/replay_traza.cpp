@@ -0,0 +1,254 @@
+// bench/replay_traza.cpp
+// Reproduce una traza grabada con BuddyAllocator::iniciarTraza contra uno o
+// varios backends y reporta rendimiento, percentiles de latencia por
+// operación y huella máxima. Sirve para ajustar el tamaño del pool (-pool)
+// sin volver a procesar imágenes. Para añadir una estrategia nueva basta con
+// implementar Backend y registrarla en crearBackend().
+//
+// Uso: ./replay_traza traza.bin [-pool MB] [buddy] [clasico] [malloc] [pmr]
+
+#include "buddy_allocator.h"
+#include "buddy_allocator_clasico.h"
+#include "buddy_memory_resource.h"
+#include "buddy_traza.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <malloc.h>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using Reloj = std::chrono::steady_clock;
+
+class Backend {
+public:
+    virtual ~Backend() {}
+    virtual const char* nombre() const = 0;
+    virtual void* alloc(size_t tam) = 0;
+    virtual void free(void* p, size_t tam) = 0;
+    virtual void* realloc(void* p, size_t tamPrevio, size_t tam) = 0;
+    // Bytes que consume realmente una asignación viva
+    virtual size_t huella(void* p, size_t tam) const = 0;
+    // Memoria reservada al sistema al terminar (0 si no aplica)
+    virtual size_t reservado() const { return 0; }
+};
+
+// Bloque potencia de 2 (mínimo 64 bytes) que ocupa una petición; el buddy
+// clásico suma además su cabecera de 16 bytes
+static size_t bloqueBuddy(size_t tam, size_t cabecera = 0) {
+    size_t b = 64;
+    while (b < std::max<size_t>(tam, 64) + cabecera) b <<= 1;
+    return b;
+}
+
+class BackendBuddy : public Backend {
+public:
+    explicit BackendBuddy(size_t pool) : a(pool) {}
+    const char* nombre() const override { return "buddy"; }
+    void* alloc(size_t tam) override { return a.alloc(tam); }
+    void free(void* p, size_t) override { a.free(p); }
+    void* realloc(void* p, size_t, size_t tam) override { return a.realloc(p, tam); }
+    size_t huella(void*, size_t tam) const override { return bloqueBuddy(tam); }
+    size_t reservado() const override { return a.getTotalSize(); }
+private:
+    BuddyAllocator a;
+};
+
+class BackendClasico : public Backend {
+public:
+    explicit BackendClasico(size_t pool) : a(pool) {}
+    const char* nombre() const override { return "clasico"; }
+    void* alloc(size_t tam) override { return a.alloc(tam); }
+    void free(void* p, size_t) override { a.free(p); }
+    void* realloc(void* p, size_t, size_t tam) override { return a.realloc(p, tam); }
+    size_t huella(void*, size_t tam) const override { return bloqueBuddy(tam, 16); }
+    size_t reservado() const override { return a.getTotalSize(); }
+private:
+    BuddyAllocatorClasico a;
+};
+
+class BackendMalloc : public Backend {
+public:
+    const char* nombre() const override { return "malloc"; }
+    void* alloc(size_t tam) override { return std::malloc(tam); }
+    void free(void* p, size_t) override { std::free(p); }
+    void* realloc(void* p, size_t, size_t tam) override { return std::realloc(p, tam); }
+    size_t huella(void* p, size_t) const override { return malloc_usable_size(p); }
+};
+
+// Pool de clases de tamaño de la STL encima del buddy (BuddyMemoryResource):
+// los tamaños pequeños los agrupa la pmr y los grandes pasan al buddy
+class BackendPmr : public Backend {
+public:
+    explicit BackendPmr(size_t pool) : a(pool), recurso(a), pmr(&recurso) {}
+    const char* nombre() const override { return "pmr"; }
+    void* alloc(size_t tam) override {
+        try {
+            return pmr.allocate(std::max<size_t>(tam, 1));
+        } catch (const std::bad_alloc&) {
+            return nullptr;
+        }
+    }
+    void free(void* p, size_t tam) override { pmr.deallocate(p, std::max<size_t>(tam, 1)); }
+    void* realloc(void* p, size_t tamPrevio, size_t tam) override {
+        void* n = alloc(tam);
+        if (n && p) std::memcpy(n, p, std::min(tamPrevio, tam));
+        if (n && p) free(p, tamPrevio);
+        return n;
+    }
+    // La pmr no expone cuánto ocupa cada bloque: se cuenta lo solicitado
+    size_t huella(void*, size_t tam) const override { return tam; }
+    size_t reservado() const override { return a.getTotalSize(); }
+private:
+    BuddyAllocator a;
+    BuddyMemoryResource recurso;
+    std::pmr::unsynchronized_pool_resource pmr;
+};
+
+static std::unique_ptr<Backend> crearBackend(const std::string& nombre, size_t pool) {
+    if (nombre == "buddy") return std::unique_ptr<Backend>(new BackendBuddy(pool));
+    if (nombre == "clasico") return std::unique_ptr<Backend>(new BackendClasico(pool));
+    if (nombre == "malloc") return std::unique_ptr<Backend>(new BackendMalloc());
+    if (nombre == "pmr") return std::unique_ptr<Backend>(new BackendPmr(pool));
+    return nullptr;
+}
+
+static bool leerTraza(const char* ruta, std::vector<RegistroTraza>& registros) {
+    FILE* f = std::fopen(ruta, "rb");
+    if (!f) {
+        std::fprintf(stderr, "Error: no se pudo abrir '%s'\n", ruta);
+        return false;
+    }
+    CabeceraTraza cab;
+    if (std::fread(&cab, sizeof(cab), 1, f) != 1 ||
+        std::memcmp(cab.magia, MAGIA_TRAZA, sizeof(cab.magia)) != 0 ||
+        cab.version != VERSION_TRAZA || cab.tamRegistro != sizeof(RegistroTraza)) {
+        std::fprintf(stderr, "Error: '%s' no es una traza válida\n", ruta);
+        std::fclose(f);
+        return false;
+    }
+    RegistroTraza r;
+    while (std::fread(&r, sizeof(r), 1, f) == 1) registros.push_back(r);
+    std::fclose(f);
+    return true;
+}
+
+static double percentil(std::vector<uint32_t>& v, double p) {
+    if (v.empty()) return 0;
+    size_t i = std::min(v.size() - 1, static_cast<size_t>(p * (v.size() - 1) + 0.5));
+    return v[i];
+}
+
+static void informar(const char* op, std::vector<uint32_t>& lat) {
+    if (lat.empty()) return;
+    std::sort(lat.begin(), lat.end());
+    std::printf("  %-8s %10zu %9.0f %9.0f %9.0f %9.0f %11u\n", op, lat.size(),
+                percentil(lat, 0.50), percentil(lat, 0.90), percentil(lat, 0.99),
+                percentil(lat, 0.999), lat.back());
+}
+
+static void reproducir(Backend& b, const std::vector<RegistroTraza>& registros) {
+    struct Vivo { void* p; size_t tam; };
+    std::unordered_map<uint64_t, Vivo> vivos;
+    std::vector<uint32_t> latAlloc, latFree, latRealloc;
+    size_t huellaActual = 0, huellaPico = 0, fallos = 0;
+
+    auto cronometrar = [](Reloj::time_point t0) {
+        return static_cast<uint32_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(Reloj::now() - t0).count());
+    };
+
+    auto t0Total = Reloj::now();
+    for (const RegistroTraza& r : registros) {
+        size_t tam = tamDe(r);
+        switch (opDe(r)) {
+        case TRAZA_ALLOC: {
+            if (!r.id) break;  // También falló al grabar
+            auto t0 = Reloj::now();
+            void* p = b.alloc(tam);
+            latAlloc.push_back(cronometrar(t0));
+            if (!p) { ++fallos; break; }
+            vivos[r.id] = {p, tam};
+            huellaActual += b.huella(p, tam);
+            break;
+        }
+        case TRAZA_FREE: {
+            auto it = vivos.find(r.id);
+            if (it == vivos.end()) break;
+            huellaActual -= b.huella(it->second.p, it->second.tam);
+            auto t0 = Reloj::now();
+            b.free(it->second.p, it->second.tam);
+            latFree.push_back(cronometrar(t0));
+            vivos.erase(it);
+            break;
+        }
+        case TRAZA_REALLOC: {
+            if (!r.id) break;
+            auto it = vivos.find(r.idPrevio);
+            void* previo = it != vivos.end() ? it->second.p : nullptr;
+            size_t tamPrevio = previo ? it->second.tam : 0;
+            if (previo) huellaActual -= b.huella(previo, tamPrevio);
+            auto t0 = Reloj::now();
+            void* p = b.realloc(previo, tamPrevio, tam);
+            latRealloc.push_back(cronometrar(t0));
+            if (it != vivos.end()) vivos.erase(it);
+            if (!p) { ++fallos; break; }
+            vivos[r.id] = {p, tam};
+            huellaActual += b.huella(p, tam);
+            break;
+        }
+        }
+        huellaPico = std::max(huellaPico, huellaActual);
+    }
+    double seg = std::chrono::duration<double>(Reloj::now() - t0Total).count();
+
+    for (auto& v : vivos) b.free(v.second.p, v.second.tam);
+
+    size_t ops = latAlloc.size() + latFree.size() + latRealloc.size();
+    const double MB = 1024.0 * 1024.0;
+    std::printf("[%s] %zu ops en %.3f s (%.2f Mops/s), fallos %zu\n", b.nombre(), ops, seg,
+                ops / seg / 1e6, fallos);
+    std::printf("  huella pico %.2f MB", huellaPico / MB);
+    if (b.reservado()) std::printf(", reservado %.2f MB", b.reservado() / MB);
+    std::printf("\n");
+    std::printf("  %-8s %10s %9s %9s %9s %9s %11s   (ns)\n", "op", "n", "p50", "p90", "p99",
+                "p99.9", "max");
+    informar("alloc", latAlloc);
+    informar("free", latFree);
+    informar("realloc", latRealloc);
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::fprintf(stderr, "Uso: %s traza.bin [-pool MB] [buddy] [clasico] [malloc] [pmr]\n",
+                     argv[0]);
+        return 1;
+    }
+
+    size_t pool = 256;
+    std::vector<std::string> nombres;
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "-pool" && i + 1 < argc) pool = std::strtoull(argv[++i], nullptr, 10);
+        else nombres.push_back(arg);
+    }
+    if (nombres.empty()) nombres = {"buddy", "clasico", "malloc", "pmr"};
+
+    std::vector<RegistroTraza> registros;
+    if (!leerTraza(argv[1], registros)) return 1;
+    std::printf("Traza '%s': %zu registros, pool %zu MB\n", argv[1], registros.size(), pool);
+
+    for (const std::string& n : nombres) {
+        std::unique_ptr<Backend> b = crearBackend(n, pool * 1024 * 1024);
+        if (!b) {
+            std::fprintf(stderr, "Backend desconocido: %s\n", n.c_str());
+            continue;
+        }
+        reproducir(*b, registros);
+    }
+    return 0;
+}
@@ -1,48 +1,638 @@
 // buddy_system/buddy_allocator.cpp
 #include "buddy_allocator.h"
+#include <cerrno>
 #include <cmath>
 #include <cstdlib>
 #include <cstring>
 #include <iostream>
 #include <algorithm>
-#include <cstdint>
+#include <atomic>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+#include <fcntl.h>
+#include <sched.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <linux/mempolicy.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
 
 const size_t BuddyAllocator::MIN_BLOCK_SIZE;
+const size_t BuddyAllocator::TAM_PAGINA;
+const size_t BuddyAllocator::TAM_PAGINA_GRANDE;
+const size_t BuddyAllocator::CAPACIDAD_TRAZA;
+const size_t BuddyAllocator::MIN_COMPUESTO;
+const size_t BuddyAllocator::TAM_GRANULO;
+const int BuddyAllocator::NIVEL_GRANULO;
+const size_t BuddyAllocator::MAX_OBJETO_SLAB;
+const size_t BuddyAllocator::TAM_SLAB;
+const size_t BuddyAllocator::MIN_OBJETO_SLAB;
+const uint64_t BuddyAllocator::SIN_DESPLAZAMIENTO;
+const int BuddyAllocator::MAX_ENTRADAS_INDICE;
+const size_t BuddyAllocator::MAX_CLAVE_INDICE;
 
-BuddyAllocator::BuddyAllocator(size_t size) {
+// Histogramas de latencia (make LATENCIAS=1): sin la macro las medidas se
+// descartan al compilar (if constexpr) y no se reserva el histograma
+#ifdef BUDDY_LATENCIAS
+static constexpr bool MEDIR_LATENCIAS = true;
+#else
+static constexpr bool MEDIR_LATENCIAS = false;
+#endif
+
+// Cubeta c: latencias en [2^c, 2^(c+1)) ciclos (la 0 incluye el 0); la
+// última se queda con todo lo que la supere
+static const int CUBETAS_LATENCIA = 40;
+
+struct BuddyAllocator::HistogramasLatencia {
+    std::atomic<uint64_t> cubetas[BuddyEstadisticas::NUM_OPERACIONES_LATENCIA]
+                                 [BuddyEstadisticas::MAX_NIVELES][CUBETAS_LATENCIA];
+    std::atomic<uint64_t> maximo[BuddyEstadisticas::NUM_OPERACIONES_LATENCIA]
+                                [BuddyEstadisticas::MAX_NIVELES];
+};
+
+// rdtsc en x86: unas decenas de ciclos y sin llamada al sistema. No serializa,
+// así que una operación muy corta (un split) puede salir algo desplazada
+static inline uint64_t leerCiclos() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+}
+
+// Valores de Arena::respaldo
+enum { RESPALDO_NORMAL = 0, RESPALDO_HUGETLB = 1, RESPALDO_THP = 2, RESPALDO_COMPARTIDO = 3 };
+
+// Cabecera del segmento compartido: "BUDDYSHM" y versión del formato
+static const uint64_t MAGIA_COMPARTIDA = 0x4d48535944445542ULL;
+static const uint32_t VERSION_COMPARTIDA = 2;
+
+static void iniciarCerrojoCompartido(pthread_mutex_t* m) {
+    pthread_mutexattr_t atributos;
+    pthread_mutexattr_init(&atributos);
+    pthread_mutexattr_setpshared(&atributos, PTHREAD_PROCESS_SHARED);
+    pthread_mutexattr_setrobust(&atributos, PTHREAD_MUTEX_ROBUST);
+    pthread_mutex_init(m, &atributos);
+    pthread_mutexattr_destroy(&atributos);
+}
+
+// Escribe un byte en cada página de [ini, ini + tam) repartiendo el rango
+// entre varios hilos: el núcleo atiende en paralelo los fallos de página.
+// Sólo se usa con memoria recién mapeada, que aún vale cero.
+static void tocarPaginas(char* ini, size_t tam) {
+    const size_t pagina = 4096;
+    const size_t minimoPorHilo = 16 * 1024 * 1024;
+    size_t paginas = (tam + pagina - 1) / pagina;
+    size_t hilos = std::max<size_t>(1, std::thread::hardware_concurrency());
+    hilos = std::min(hilos, std::max<size_t>(1, tam / minimoPorHilo));
+
+    auto tocar = [=](size_t desde, size_t hasta) {
+        for (size_t i = desde; i < hasta; ++i) {
+            *reinterpret_cast<volatile char*>(ini + i * pagina) = 0;
+        }
+    };
+    std::vector<std::thread> trabajadores;
+    size_t porHilo = (paginas + hilos - 1) / hilos;
+    for (size_t h = 1; h < hilos; ++h) {
+        trabajadores.emplace_back(tocar, std::min(paginas, h * porHilo),
+                                  std::min(paginas, (h + 1) * porHilo));
+    }
+    tocar(0, std::min(paginas, porHilo));
+    for (std::thread& t : trabajadores) t.join();
+}
+
+// Bytes de [ini, ini + tam) con página física asignada (ini alineado a página)
+static size_t medirResidentes(void* ini, size_t tam) {
+    const size_t pagina = 4096;
+    std::vector<unsigned char> paginas((tam + pagina - 1) / pagina);
+    if (mincore(ini, tam, paginas.data()) != 0) return 0;
+    size_t residentes = 0;
+    for (unsigned char p : paginas) residentes += p & 1;
+    return residentes * pagina;
+}
+
+// Nodo NUMA de la CPU en la que corre el hilo llamador
+static int nodoHiloActual() {
+    unsigned cpu = 0, nodo = 0;
+    if (syscall(SYS_getcpu, &cpu, &nodo, nullptr) != 0) return 0;
+    return static_cast<int>(nodo);
+}
+
+// Ranuras de hilo compartidas por todos los allocators concurrentes. Cada hilo
+// ocupa una ranura (bit) mientras vive y la devuelve al terminar; un hilo nuevo
+// hereda los cargadores de la ranura, cuyos bloques siguen siendo válidos.
+static std::atomic<uint64_t> ranurasOcupadas{0};
+
+namespace {
+struct RanuraHilo {
+    int id = -2;  // -2: sin pedir, -1: no quedan ranuras (se usa el cerrojo)
+    ~RanuraHilo() {
+        if (id >= 0) ranurasOcupadas.fetch_and(~(1ULL << id), std::memory_order_release);
+    }
+};
+}
+
+static int ranuraHiloActual() {
+    static thread_local RanuraHilo ranura;
+    if (ranura.id != -2) return ranura.id;
+
+    uint64_t ocupadas = ranurasOcupadas.load(std::memory_order_relaxed);
+    ranura.id = -1;
+    while (~ocupadas) {
+        int libre = __builtin_ctzll(~ocupadas);
+        if (ranurasOcupadas.compare_exchange_weak(ocupadas, ocupadas | (1ULL << libre),
+                                                  std::memory_order_acquire)) {
+            ranura.id = libre;
+            break;
+        }
+    }
+    return ranura.id;
+}
+
+// El pool compartido restringe algunas opciones (ver BuddyOpciones::compartido)
+static bool pideCompartido(const BuddyOpciones& o) {
+    return o.compartido || !o.nombreCompartido.empty() || o.fdCompartido >= 0 ||
+           !o.archivoPersistente.empty();
+}
+
+BuddyAllocator::BuddyAllocator(size_t size, const BuddyOpciones& opciones)
+    : numArenas(0), totalSize(0), crecer(opciones.crecer && !pideCompartido(opciones)),
+      respaldo(pideCompartido(opciones) ? RespaldoPool::Normal : opciones.respaldo),
+      numaLocal(opciones.numaLocal && !pideCompartido(opciones)), precarga(opciones.precarga),
+      marcaDiferida(opciones.marcaDiferida),
+      compuestos(opciones.compuestos), devolverDesde(opciones.devolverDesde),
+      devolucionPerezosa(opciones.devolucionPerezosa),
+      concurrente(opciones.concurrente || opciones.intervaloTrim.count() > 0 ||
+                  pideCompartido(opciones)),
+      slabs(opciones.slabs && !pideCompartido(opciones)), fdSegmento(-1),
+      contAllocs(0), contFrees(0), contSplits(0), contCoalesces(0), contFallos(0), contDiferidos(0),
+      contCompuestos(0), bytesRecortados(0), contTrims(0), bytesDevueltos(0),
+      bytesEnUso(0), bytesSolicitados(0), picoBytesEnUso(0),
+      contAllocsSlab(0), contFreesSlab(0), bytesEtiqueta(), picoEtiqueta(),
+      latencias(nullptr),
+      pararTrim(false),
+      trazaFd(-1), trazaBuffer(nullptr), trazaCuenta(0) {
+    if constexpr (MEDIR_LATENCIAS) latencias = new HistogramasLatencia();
     // Redondear al siguiente poder de 2
-    totalSize = 1ULL << static_cast<int>(std::ceil(std::log2(size)));
-    
-    // Alinear memoria a 64 bytes
-    posix_memalign(&memoryBase, 64, totalSize);
-    if (!memoryBase) {
+    size = std::max(size, MIN_BLOCK_SIZE);
+    tamArenaBase = 1ULL << static_cast<int>(std::ceil(std::log2(size)));
+
+    for (ClaseSlab& c : clasesSlab) {
+        c.parciales = nullptr;
+        c.slabs = 0;
+        c.objetos = 0;
+    }
+
+    // Los cargadores se mapean una sola vez; no dependen de cuántas arenas haya
+    cargadores = nullptr;
+    bytesCargadores = 0;
+    // Sin cargadores en el pool compartido: un proceso que terminara con
+    // bloques en sus cargadores los perdería para todos
+    if (concurrente && !pideCompartido(opciones)) {
+        bytesCargadores = MAX_HILOS * NIVELES_CACHE * sizeof(Cargador);
+        void* m = mmap(nullptr, bytesCargadores, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (m == MAP_FAILED) {
+            std::cerr << "Error: no se pudo reservar memoria para los cargadores\n";
+            std::exit(1);
+        }
+        cargadores = static_cast<Cargador*>(m);
+    }
+
+    if (pideCompartido(opciones)) {
+        if (!abrirCompartido(opciones)) {
+            std::cerr << "Error: no se pudo crear ni adjuntar el pool "
+                      << (opciones.archivoPersistente.empty() ? "compartido" : "persistente") << "\n";
+            std::exit(1);
+        }
+    } else if (!crearArena(tamArenaBase, numaLocal ? nodoHiloActual() : -1)) {
         std::cerr << "Error: no se pudo reservar memoria inicial alineada\n";
         std::exit(1);
     }
 
-    std::memset(freeLists, 0, sizeof(freeLists));
-    cacheMemory = nullptr;
-    cacheSize = 0;
-
-    int level = getLevel(totalSize);
-    freeLists[level] = static_cast<Block*>(memoryBase);
-    freeLists[level]->next = nullptr;
-    freeLists[level]->size = totalSize;
+    if (opciones.intervaloTrim.count() > 0) {
+        hiloTrim = std::thread(&BuddyAllocator::bucleTrim, this, opciones.intervaloTrim);
+    }
 }
 
 BuddyAllocator::~BuddyAllocator() {
-    if (cacheMemory) std::free(cacheMemory);
-    std::free(memoryBase);
+    if (hiloTrim.joinable()) {
+        {
+            std::lock_guard<std::mutex> guard(cerrojoTrim);
+            pararTrim = true;
+        }
+        avisoTrim.notify_one();
+        hiloTrim.join();
+    }
+    detenerTraza();
+    for (int i = 0; i < numArenas.load(); ++i) {
+        if (arenas[i]->respaldo == RESPALDO_COMPARTIDO) {
+            munmap(arenas[i]->base() - TAM_PAGINA, arenas[i]->tamMapeo + TAM_PAGINA);
+        } else {
+            munmap(arenas[i]->base(), arenas[i]->tamMapeo);
+        }
+    }
+    if (cargadores) munmap(cargadores, bytesCargadores);
+    if (fdSegmento >= 0) close(fdSegmento);
+    delete latencias;
 }
 
-int BuddyAllocator::getLevel(size_t size) const {
-    size = std::max(size, MIN_BLOCK_SIZE);
-    size_t paddedSize = size + sizeof(Block);
+void BuddyAllocator::CerrojoNucleo::lock() {
+    if (!compartido) {
+        local.lock();
+        return;
+    }
+    // Otro proceso murió con el cerrojo: sus cambios pueden estar a medias,
+    // pero bloquear a todos los demás sería peor
+    if (pthread_mutex_lock(compartido) == EOWNERDEAD) {
+        std::cerr << "Aviso: un proceso terminó con el cerrojo del pool compartido tomado\n";
+        pthread_mutex_consistent(compartido);
+    }
+}
+
+void BuddyAllocator::CerrojoNucleo::unlock() {
+    if (compartido) pthread_mutex_unlock(compartido);
+    else local.unlock();
+}
+
+// Crea el segmento (y su única arena) o se adjunta a uno ya inicializado.
+// El segmento es [CabeceraCompartida, una página][árbol][Arena][bitmaps][metas].
+bool BuddyAllocator::abrirCompartido(const BuddyOpciones& opciones) {
+    if (!opciones.archivoPersistente.empty()) return abrirPersistente(opciones.archivoPersistente);
+
+    bool nuevo;
+    if (!opciones.nombreCompartido.empty()) {
+        const char* nombre = opciones.nombreCompartido.c_str();
+        fdSegmento = shm_open(nombre, O_RDWR | O_CREAT | O_EXCL, 0600);
+        nuevo = fdSegmento >= 0;
+        if (!nuevo && errno == EEXIST) fdSegmento = shm_open(nombre, O_RDWR, 0);
+    } else if (opciones.fdCompartido >= 0) {
+        fdSegmento = dup(opciones.fdCompartido);
+        struct stat st;
+        nuevo = fdSegmento >= 0 && fstat(fdSegmento, &st) == 0 && st.st_size == 0;
+    } else {
+        fdSegmento = static_cast<int>(syscall(SYS_memfd_create, "buddy_pool", 0));
+        nuevo = true;
+    }
+    if (fdSegmento < 0) return false;
+    return nuevo ? inicializarCompartido() : adjuntarCompartido();
+}
+
+bool BuddyAllocator::inicializarCompartido() {
+    Arena* a = crearArena(tamArenaBase, -1);
+    if (!a) return false;
+
+    // El índice empieza vacío: la página de cabecera llega a cero
+    CabeceraCompartida* cab = reinterpret_cast<CabeceraCompartida*>(a->base() - TAM_PAGINA);
+    cab->magia = MAGIA_COMPARTIDA;
+    cab->version = VERSION_COMPARTIDA;
+    cab->tamano = a->tamano;
+    iniciarCerrojoCompartido(&cab->cerrojo);
+    cerrojo.compartir(&cab->cerrojo);
+    cab->listo.store(1, std::memory_order_release);
+    return true;
+}
+
+bool BuddyAllocator::adjuntarCompartido(bool esperar) {
+    // Quien lo crea dimensiona el objeto antes de inicializarlo: se espera a
+    // que publique la cabecera (como mucho unos segundos)
+    CabeceraCompartida* cab = nullptr;
+    struct stat st;
+    for (int intento = 0; intento < (esperar ? 5000 : 1); ++intento) {
+        if (fstat(fdSegmento, &st) != 0) return false;
+        if (!cab && static_cast<size_t>(st.st_size) >= TAM_PAGINA) {
+            void* m = mmap(nullptr, TAM_PAGINA, PROT_READ, MAP_SHARED, fdSegmento, 0);
+            if (m == MAP_FAILED) return false;
+            cab = static_cast<CabeceraCompartida*>(m);
+        }
+        if (cab && cab->listo.load(std::memory_order_acquire)) break;
+        if (esperar) usleep(1000);
+    }
+    bool valida = cab && cab->listo.load(std::memory_order_acquire) &&
+                  cab->magia == MAGIA_COMPARTIDA && cab->version == VERSION_COMPARTIDA;
+    size_t tamano = valida ? cab->tamano : 0;
+    if (cab) munmap(cab, TAM_PAGINA);
+    if (!valida) {
+        std::cerr << "Error: el segmento compartido no es un pool buddy válido\n";
+        return false;
+    }
+
+    void* m = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fdSegmento, 0);
+    if (m == MAP_FAILED) return false;
+    cab = static_cast<CabeceraCompartida*>(m);
+    Arena* a = reinterpret_cast<Arena*>(static_cast<char*>(m) + TAM_PAGINA + tamano);
+    if (a->tamano != tamano || a->tamMapeo + TAM_PAGINA > static_cast<size_t>(st.st_size)) {
+        munmap(m, st.st_size);
+        return false;
+    }
+    cerrojo.compartir(&cab->cerrojo);
+    tamArenaBase = tamano;
+    arenas[0] = a;
+    totalSize.store(tamano, std::memory_order_relaxed);
+    numArenas.store(1, std::memory_order_release);
+    return true;
+}
+
+bool BuddyAllocator::eliminarCompartido(const char* nombre) {
+    return shm_unlink(nombre) == 0;
+}
+
+// Cada proceso adjunto al fichero mantiene un flock compartido. Quien
+// consigue el exclusivo es el único usuario: crea el pool, o revisa el que
+// dejaron procesos anteriores, antes de dejar entrar a los demás.
+bool BuddyAllocator::abrirPersistente(const std::string& ruta) {
+    fdSegmento = open(ruta.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (fdSegmento < 0) return false;
+    if (flock(fdSegmento, LOCK_EX | LOCK_NB) != 0) {
+        return flock(fdSegmento, LOCK_SH) == 0 && adjuntarCompartido();
+    }
+
+    // Un fichero con otro contenido no se pisa nunca
+    struct {
+        uint64_t magia;
+        uint32_t version;
+        uint32_t listo;
+    } previa = {};
+    struct stat st;
+    if (fstat(fdSegmento, &st) != 0) return false;
+    if (st.st_size > 0 && (pread(fdSegmento, &previa, sizeof(previa), 0) != sizeof(previa) ||
+                           previa.magia != MAGIA_COMPARTIDA)) {
+        std::cerr << "Error: '" << ruta << "' no es un pool buddy\n";
+        return false;
+    }
+
+    size_t pedido = tamArenaBase;
+    bool reutilizar = st.st_size > 0 && previa.version == VERSION_COMPARTIDA && previa.listo &&
+                      adjuntarCompartido(false);
+    if (reutilizar) {
+        // Sin otros procesos, un cerrojo tomado es de uno que murió (o de
+        // antes de reiniciar la máquina) a medio cambio: no se confía en el pool
+        // (se suelta antes de reiniciarlo: glibc lo enlaza en la lista de
+        // mutex robustos del hilo mientras está tomado)
+        CabeceraCompartida* cab = cabeceraCompartida();
+        int estado = pthread_mutex_trylock(&cab->cerrojo);
+        if (estado == EOWNERDEAD) pthread_mutex_consistent(&cab->cerrojo);
+        if (estado == 0 || estado == EOWNERDEAD) pthread_mutex_unlock(&cab->cerrojo);
+        bool limpio = estado == 0;
+        iniciarCerrojoCompartido(&cab->cerrojo);
+        if (!limpio || !indiceCoherente()) {
+            std::cerr << "Aviso: el pool de '" << ruta << "' quedó a medias; se vacía\n";
+            munmap(arenas[0]->base() - TAM_PAGINA, arenas[0]->tamMapeo + TAM_PAGINA);
+            numArenas.store(0, std::memory_order_release);
+            totalSize.store(0, std::memory_order_relaxed);
+            reutilizar = false;
+        }
+    }
+    if (!reutilizar) {
+        tamArenaBase = pedido;
+        if (ftruncate(fdSegmento, 0) != 0 || !inicializarCompartido()) return false;
+    }
+    return flock(fdSegmento, LOCK_SH) == 0;
+}
+
+// Con un único usuario, todo bloque ocupado debe estar en el índice: si no,
+// lo dejó huérfano un proceso que murió y nadie lo liberaría nunca
+bool BuddyAllocator::indiceCoherente() {
+    Arena* a = arenas[0];
+    size_t libres = 0;
+    for (int l = 0; l < a->numLevels; ++l) libres += a->cuentaLibres[l] * getBlockSize(l);
+
+    CabeceraCompartida* cab = cabeceraCompartida();
+    size_t indexados = 0;
+    for (const EntradaIndice& e : cab->indice) {
+        if (!e.clave[0]) continue;
+        if (e.desplazamiento >= a->tamano || e.desplazamiento % MIN_BLOCK_SIZE) return false;
+        MetaBloque* m = metaDe(a, a->base() + e.desplazamiento);
+        if (!m->asignado || m->slab) return false;
+        indexados += huellaBloque(*m);
+    }
+    return indexados + libres == a->tamano;
+}
+
+BuddyAllocator::CabeceraCompartida* BuddyAllocator::cabeceraCompartida() const {
+    if (!esCompartido() || getNumArenas() == 0) return nullptr;
+    return reinterpret_cast<CabeceraCompartida*>(arenas[0]->base() - TAM_PAGINA);
+}
+
+bool BuddyAllocator::publicarEnIndice(const char* clave, const void* ptr, const uint32_t* datos) {
+    CabeceraCompartida* cab = cabeceraCompartida();
+    uint64_t desplazamiento = desplazamientoDe(ptr);
+    if (!cab || !clave[0] || std::strlen(clave) >= MAX_CLAVE_INDICE ||
+        desplazamiento == SIN_DESPLAZAMIENTO || desplazamiento % MIN_BLOCK_SIZE) {
+        return false;
+    }
+
+    std::lock_guard<CerrojoNucleo> guard(cerrojo);
+    if (!metaDe(arenas[0], ptr)->asignado) return false;
+    EntradaIndice* libre = nullptr;
+    for (EntradaIndice& e : cab->indice) {
+        if (!e.clave[0]) {
+            if (!libre) libre = &e;
+        } else if (std::strcmp(e.clave, clave) == 0) {
+            return false;
+        }
+    }
+    if (!libre) return false;
+    libre->desplazamiento = desplazamiento;
+    libre->secuencia = ++cab->secuencia;
+    for (int i = 0; i < 4; ++i) libre->datos[i] = datos ? datos[i] : 0;
+    std::strcpy(libre->clave, clave);
+    return true;
+}
+
+void* BuddyAllocator::buscarEnIndice(const char* clave, EntradaIndice* entrada) const {
+    CabeceraCompartida* cab = cabeceraCompartida();
+    if (!cab) return nullptr;
+
+    std::lock_guard<CerrojoNucleo> guard(cerrojo);
+    for (const EntradaIndice& e : cab->indice) {
+        if (e.clave[0] && std::strcmp(e.clave, clave) == 0) {
+            if (entrada) *entrada = e;
+            return arenas[0]->base() + e.desplazamiento;
+        }
+    }
+    return nullptr;
+}
+
+void* BuddyAllocator::retirarDelIndice(const char* clave) {
+    CabeceraCompartida* cab = cabeceraCompartida();
+    if (!cab) return nullptr;
+
+    std::lock_guard<CerrojoNucleo> guard(cerrojo);
+    for (EntradaIndice& e : cab->indice) {
+        if (e.clave[0] && std::strcmp(e.clave, clave) == 0) {
+            e.clave[0] = '\0';
+            return arenas[0]->base() + e.desplazamiento;
+        }
+    }
+    return nullptr;
+}
 
+int BuddyAllocator::leerIndice(EntradaIndice* salida, int max) const {
+    CabeceraCompartida* cab = cabeceraCompartida();
+    if (!cab) return 0;
+
+    std::lock_guard<CerrojoNucleo> guard(cerrojo);
+    int n = 0;
+    for (const EntradaIndice& e : cab->indice) {
+        if (e.clave[0] && n < max) salida[n++] = e;
+    }
+    return n;
+}
+
+uint64_t BuddyAllocator::desplazamientoDe(const void* ptr) const {
+    if (getNumArenas() == 0 || !arenas[0]->contiene(ptr)) return SIN_DESPLAZAMIENTO;
+    return static_cast<const char*>(ptr) - arenas[0]->base();
+}
+
+void* BuddyAllocator::punteroDe(uint64_t desplazamiento) const {
+    if (getNumArenas() == 0 || desplazamiento >= arenas[0]->tamano) return nullptr;
+    return arenas[0]->base() + desplazamiento;
+}
+
+// Reserva la región de una arena según el respaldo pedido. Con páginas grandes
+// se intenta MAP_HUGETLB (tamaño múltiplo de 2 MB); si el sistema no tiene
+// páginas reservadas se mapea alineado a 2 MB y se sugiere THP con madvise.
+void* BuddyAllocator::mapearRegion(size_t& tamMapeo, int& respaldoObtenido, bool poblar) const {
+    const int flags = MAP_PRIVATE | MAP_ANONYMOUS | (poblar ? MAP_POPULATE : 0);
+    respaldoObtenido = RESPALDO_NORMAL;
+
+    if (respaldo == RespaldoPool::PaginasGrandes) {
+        size_t tamGrande = (tamMapeo + TAM_PAGINA_GRANDE - 1) & ~(TAM_PAGINA_GRANDE - 1);
+        void* m = mmap(nullptr, tamGrande, PROT_READ | PROT_WRITE, flags | MAP_HUGETLB, -1, 0);
+        if (m != MAP_FAILED) {
+            tamMapeo = tamGrande;
+            respaldoObtenido = RESPALDO_HUGETLB;
+            return m;
+        }
+
+        // Sobre-mapear para poder recortar a un inicio alineado a 2 MB
+        void* bruto = mmap(nullptr, tamGrande + TAM_PAGINA_GRANDE, PROT_READ | PROT_WRITE,
+                           flags, -1, 0);
+        if (bruto == MAP_FAILED) return nullptr;
+        uintptr_t ini = reinterpret_cast<uintptr_t>(bruto);
+        uintptr_t alineado = (ini + TAM_PAGINA_GRANDE - 1) & ~(TAM_PAGINA_GRANDE - 1);
+        if (alineado > ini) munmap(bruto, alineado - ini);
+        size_t cola = (ini + tamGrande + TAM_PAGINA_GRANDE) - (alineado + tamGrande);
+        if (cola) munmap(reinterpret_cast<void*>(alineado + tamGrande), cola);
+
+        tamMapeo = tamGrande;
+        if (madvise(reinterpret_cast<void*>(alineado), tamGrande, MADV_HUGEPAGE) == 0) {
+            respaldoObtenido = RESPALDO_THP;
+        }
+        return reinterpret_cast<void*>(alineado);
+    }
+
+    void* m = mmap(nullptr, tamMapeo, PROT_READ | PROT_WRITE, flags, -1, 0);
+    return m == MAP_FAILED ? nullptr : m;
+}
+
+// Mapea una arena nueva: [árbol buddy de `tamano` bytes][Arena][bitmaps][metas].
+// El árbol va primero para que sus bloques hereden la alineación de página.
+BuddyAllocator::Arena* BuddyAllocator::crearArena(size_t tamano, int nodo) {
+    int n = numArenas.load(std::memory_order_relaxed);
+    if (n == MAX_ARENAS) return nullptr;
+
+    // Número de niveles: desde MIN_BLOCK_SIZE hasta un único bloque del tamaño de la arena
+    int niveles = 1;
+    while (getBlockSize(niveles - 1) < tamano) ++niveles;
+    if (niveles > MAX_LEVELS) return nullptr;
+
+    // Palabras de 64 bits que necesita cada nivel en los bitmaps
+    size_t inicioBits[MAX_LEVELS];
+    size_t palabras = 0;
+    for (int l = 0; l < niveles; ++l) {
+        inicioBits[l] = palabras;
+        size_t bloques = tamano / getBlockSize(l);
+        palabras += (bloques + 63) / 64;
+    }
+    size_t tamMapeo = tamano + sizeof(Arena) + 2 * palabras * sizeof(uint64_t) +
+                      (tamano / MIN_BLOCK_SIZE) * sizeof(MetaBloque);
+
+    // Las páginas anónimas llegan a cero: bitmaps y metas empiezan vacíos
+    int respaldoObtenido;
+    bool poblar = precarga == PrecargaPool::MapPopulate && nodo < 0 &&
+                  respaldo == RespaldoPool::Normal;
+    void* m;
+    if (fdSegmento >= 0) {
+        // Segmento compartido: la arena va detrás de la página de cabecera
+        tamMapeo = (tamMapeo + TAM_PAGINA - 1) & ~(TAM_PAGINA - 1);
+        if (ftruncate(fdSegmento, tamMapeo + TAM_PAGINA) != 0) return nullptr;
+        void* s = mmap(nullptr, tamMapeo + TAM_PAGINA, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | (poblar ? MAP_POPULATE : 0), fdSegmento, 0);
+        if (s == MAP_FAILED) return nullptr;
+        m = static_cast<char*>(s) + TAM_PAGINA;
+        respaldoObtenido = RESPALDO_COMPARTIDO;
+    } else {
+        m = mapearRegion(tamMapeo, respaldoObtenido, poblar);
+    }
+    if (!m) return nullptr;
+
+    // Ligar la arena a su nodo antes de tocarla: las páginas se asignan en el
+    // primer acceso y la política preferente cae a otro nodo si éste se llena.
+    if (nodo >= 0) {
+        unsigned long mascara = 1UL << nodo;
+        syscall(SYS_mbind, m, tamMapeo, MPOL_PREFERRED, &mascara, sizeof(mascara) * 8, 0);
+    }
+    if (precarga != PrecargaPool::Ninguna && !poblar) {
+        tocarPaginas(static_cast<char*>(m), tamMapeo);
+    }
+
+    Arena* a = reinterpret_cast<Arena*>(static_cast<char*>(m) + tamano);
+    a->tamano = tamano;
+    a->tamMapeo = tamMapeo;
+    a->numLevels = niveles;
+    a->nivelesConBloques = 0;
+    a->palabrasBits = palabras;
+    a->respaldo = respaldoObtenido;
+    a->nodo = nodo;
+    for (int l = 0; l < MAX_LEVELS; ++l) {
+        a->freeLists[l] = NIL;
+        a->inicioBits[l] = l < niveles ? inicioBits[l] : 0;
+        a->cuentaLibres[l] = 0;
+    }
+    insertarLibre(a, 0, niveles - 1);
+
+    // Publicar la arena después de inicializarla: free() la busca sin cerrojo
+    arenas[n] = a;
+    totalSize.fetch_add(tamano, std::memory_order_relaxed);
+    numArenas.store(n + 1, std::memory_order_release);
+    return a;
+}
+
+const char* BuddyAllocator::getRespaldo(int arena) const {
+    if (arena < 0 || arena >= getNumArenas()) return "n/a";
+    switch (arenas[arena]->respaldo) {
+        case RESPALDO_HUGETLB: return "hugetlb";
+        case RESPALDO_THP: return "thp";
+        case RESPALDO_COMPARTIDO: return "compartido";
+        default: return "normal";
+    }
+}
+
+int BuddyAllocator::getNodoArena(int arena) const {
+    if (arena < 0 || arena >= getNumArenas()) return -1;
+    return arenas[arena]->nodo;
+}
+
+BuddyAllocator::Arena* BuddyAllocator::arenaDe(const void* ptr) const {
+    int n = numArenas.load(std::memory_order_acquire);
+    for (int i = 0; i < n; ++i) {
+        if (arenas[i]->contiene(ptr)) return arenas[i];
+    }
+    return nullptr;
+}
+
+int BuddyAllocator::getLevel(size_t size) const {
     int level = 0;
     size_t block = MIN_BLOCK_SIZE;
-    // Nunca dejar level ≥ MAX_LEVELS
-    while (block < paddedSize && level < MAX_LEVELS - 1) {
+    // Devuelve MAX_LEVELS si el tamaño no cabe en ningún bloque posible
+    while (block < size && level < MAX_LEVELS) {
         block <<= 1;
         ++level;
     }
@@ -54,145 +644,1297 @@ size_t BuddyAllocator::getBlockSize(int level) const {
 }
 
 void* BuddyAllocator::alloc(size_t size) {
-    if (size <= 4096 && cacheMemory && cacheSize >= size) {
-        void* r = cacheMemory;
-        cacheMemory = nullptr;
-        return r;
+    return alloc(size, etiquetaHiloActual());
+}
+
+void* BuddyAllocator::alloc(size_t size, EtiquetaMemoria etiqueta) {
+    void* p = sirveSlab(size, MIN_OBJETO_SLAB) ? allocSlab(size)
+                                               : allocInterno(size, MIN_BLOCK_SIZE, etiqueta);
+    if (trazaFd >= 0) registrarTraza(TRAZA_ALLOC, size, p, nullptr);
+    return p;
+}
+
+void* BuddyAllocator::allocAligned(size_t size, size_t alignment) {
+    return allocAligned(size, alignment, etiquetaHiloActual());
+}
+
+void* BuddyAllocator::allocAligned(size_t size, size_t alignment, EtiquetaMemoria etiqueta) {
+    if (alignment == 0 || (alignment & (alignment - 1)) || alignment > ALINEACION_MAXIMA) {
+        std::cerr << "Error: alineación no soportada: " << alignment << "\n";
+        return nullptr;
     }
+    void* p = sirveSlab(size, alignment) ? allocSlab(size) : allocInterno(size, alignment, etiqueta);
+    if (trazaFd >= 0) registrarTraza(TRAZA_ALLOC, std::max(size, alignment), p, nullptr);
+    return p;
+}
 
-    int level = getLevel(size);
-    size_t reqBlockSize = getBlockSize(level);
+void BuddyAllocator::free(void* ptr) {
+    // Se anota antes de liberar: otro hilo podría recibir la misma dirección
+    if (ptr && trazaFd >= 0) registrarTraza(TRAZA_FREE, 0, ptr, nullptr);
+    freeInterno(ptr);
+}
 
-    int l = level;
-    while (l < MAX_LEVELS && !freeLists[l]) ++l;
-    if (l == MAX_LEVELS) {
+// Un bloque de nivel L empieza en un múltiplo de su tamaño dentro de la
+// arena, y las arenas empiezan en página: basta con pedir un bloque de al
+// menos `alineacion` bytes.
+void* BuddyAllocator::allocInterno(size_t size, size_t alineacion, EtiquetaMemoria etiqueta) {
+    uint64_t inicio = 0;
+    if constexpr (MEDIR_LATENCIAS) inicio = leerCiclos();
+    int level = getLevel(std::max(size, alineacion));
+    size_t recorte = 0;
+    char* blockPtr;
+    if (compuestos && size >= MIN_COMPUESTO && level < MAX_LEVELS) {
+        blockPtr = allocCompuesto(level, necesarioDe(size), recorte);
+    } else {
+        blockPtr = concurrente ? allocConcurrente(level) : allocNucleo(level);
+    }
+    if (!blockPtr) {
+        sumar(contFallos, 1);
         std::cerr << "Error: no hay bloques suficientes para " << size << " bytes\n";
         return nullptr;
     }
 
+    // El núcleo ya dejó escrito el nivel (y la marca de compuesta); un bloque
+    // de un cargador puede traer la marca de slab de su uso anterior
+    MetaBloque* m = metaDe(arenaDe(blockPtr), blockPtr);
+    m->solicitado = size;
+    m->asignado = 1;
+    m->slab = 0;
+    m->etiqueta = static_cast<uint64_t>(etiqueta);
+    registrarAlloc(level, size, recorte, m->etiqueta);
+    if constexpr (MEDIR_LATENCIAS) anotarLatencia(BuddyEstadisticas::LAT_ALLOC, level, inicio);
+
+    return static_cast<void*>(blockPtr);
+}
+
+void BuddyAllocator::freeInterno(void* ptr) {
+    if (!ptr) return;
+    char* blockPtr = static_cast<char*>(ptr);
+    Arena* a = arenaDe(blockPtr);
+    if (Slab* s = a ? slabDe(a, ptr) : nullptr) {
+        freeSlab(s, ptr);
+        return;
+    }
+    if (!a || (blockPtr - a->base()) % MIN_BLOCK_SIZE != 0 || !metaDe(a, blockPtr)->asignado) {
+        std::cerr << "Error: intento de liberar un puntero no asignado\n";
+        return;
+    }
+
+    uint64_t inicio = 0;
+    if constexpr (MEDIR_LATENCIAS) inicio = leerCiclos();
+    // Copia de los metadatos: liberar limpia la entrada
+    MetaBloque meta = *metaDe(a, blockPtr);
+    bool liberado = concurrente ? freeConcurrente(a, blockPtr) : freeNucleo(a, blockPtr);
+    if (!liberado) return;
+    registrarFree(meta.nivel, meta.solicitado, getBlockSize(meta.nivel) - huellaBloque(meta),
+                  meta.etiqueta);
+    if constexpr (MEDIR_LATENCIAS) anotarLatencia(BuddyEstadisticas::LAT_FREE, meta.nivel, inicio);
+}
+
+void BuddyAllocator::sumar(std::atomic<uint64_t>& c, uint64_t v) {
+    if (concurrente) c.fetch_add(v, std::memory_order_relaxed);
+    else c.store(c.load(std::memory_order_relaxed) + v, std::memory_order_relaxed);
+}
+
+void BuddyAllocator::registrarAlloc(int level, size_t solicitado, size_t recorte, int etiqueta) {
+    sumar(contAllocs, 1);
+    size_t bloque = getBlockSize(level) - recorte;
+    if (recorte) {
+        sumar(contCompuestos, 1);
+        sumar(bytesRecortados, recorte);
+    }
+    size_t enUso;
+    if (concurrente) {
+        enUso = bytesEnUso.fetch_add(bloque, std::memory_order_relaxed) + bloque;
+        bytesSolicitados.fetch_add(solicitado, std::memory_order_relaxed);
+    } else {
+        enUso = bytesEnUso.load(std::memory_order_relaxed) + bloque;
+        bytesEnUso.store(enUso, std::memory_order_relaxed);
+        bytesSolicitados.store(bytesSolicitados.load(std::memory_order_relaxed) + solicitado,
+                               std::memory_order_relaxed);
+    }
+
+    actualizarPico(enUso);
+    sumarEtiqueta(etiqueta, bloque);
+}
+
+// Pico: sólo se escribe cuando se supera, lo habitual es una lectura
+static void subirPico(std::atomic<uint64_t>& pico, uint64_t valor) {
+    uint64_t actual = pico.load(std::memory_order_relaxed);
+    while (valor > actual &&
+           !pico.compare_exchange_weak(actual, valor, std::memory_order_relaxed)) {
+    }
+}
+
+void BuddyAllocator::actualizarPico(size_t enUso) {
+    subirPico(picoBytesEnUso, enUso);
+}
+
+// bytes en aritmética modular: un free suma el complemento
+void BuddyAllocator::sumarEtiqueta(int etiqueta, uint64_t bytes) {
+    uint64_t valor;
+    if (concurrente) {
+        valor = bytesEtiqueta[etiqueta].fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    } else {
+        valor = bytesEtiqueta[etiqueta].load(std::memory_order_relaxed) + bytes;
+        bytesEtiqueta[etiqueta].store(valor, std::memory_order_relaxed);
+    }
+    if (static_cast<int64_t>(bytes) > 0) subirPico(picoEtiqueta[etiqueta], valor);
+}
+
+bool BuddyAllocator::latenciasCompiladas() {
+    return MEDIR_LATENCIAS;
+}
+
+// Siempre fetch_add: split y coalesce corren bajo el cerrojo, pero alloc y
+// free de un cargador no
+void BuddyAllocator::anotarLatencia(int operacion, int level, uint64_t inicio) {
+    uint64_t ciclos = leerCiclos() - inicio;
+    int cubeta = std::min(63 - __builtin_clzll(ciclos | 1), CUBETAS_LATENCIA - 1);
+    latencias->cubetas[operacion][level][cubeta].fetch_add(1, std::memory_order_relaxed);
+    subirPico(latencias->maximo[operacion][level], ciclos);
+}
+
+// p50 y p99: cota superior de la cubeta donde cae el percentil, sin pasar del máximo
+static BuddyEstadisticas::Latencia resumirLatencia(const uint64_t* cubetas, uint64_t maximo) {
+    BuddyEstadisticas::Latencia l{};
+    for (int c = 0; c < CUBETAS_LATENCIA; ++c) l.muestras += cubetas[c];
+    if (!l.muestras) return l;
+    l.max = maximo;
+    uint64_t acumulado = 0;
+    for (int c = 0; c < CUBETAS_LATENCIA; ++c) {
+        acumulado += cubetas[c];
+        uint64_t cota = std::min((uint64_t{2} << c) - 1, maximo);
+        if (!l.p50 && acumulado * 2 >= l.muestras) l.p50 = cota;
+        if (acumulado * 100 >= l.muestras * 99) {
+            l.p99 = cota;
+            break;
+        }
+    }
+    return l;
+}
+
+// Un bloque que cambia de tamaño sin moverse: se ajustan los bytes en uso,
+// solicitados y recortados sin contar un alloc ni un free
+void BuddyAllocator::registrarCambio(const MetaBloque& antes, const MetaBloque& despues) {
+    uint64_t huellaAntes = huellaBloque(antes), huellaDespues = huellaBloque(despues);
+    uint64_t recorteAntes = getBlockSize(antes.nivel) - huellaAntes;
+    uint64_t recorteDespues = getBlockSize(despues.nivel) - huellaDespues;
+    sumar(bytesSolicitados,
+          static_cast<uint64_t>(despues.solicitado) - static_cast<uint64_t>(antes.solicitado));
+    sumar(bytesRecortados, recorteDespues - recorteAntes);
+    sumar(bytesEnUso, huellaDespues - huellaAntes);
+    if (huellaDespues > huellaAntes) actualizarPico(bytesEnUso.load(std::memory_order_relaxed));
+    sumarEtiqueta(antes.etiqueta, huellaDespues - huellaAntes);
+}
+
+void BuddyAllocator::registrarFree(int level, size_t solicitado, size_t recorte, int etiqueta) {
+    sumar(contFrees, 1);
+    // Restar en aritmética modular: sumar el complemento
+    sumar(bytesEnUso, 0 - (getBlockSize(level) - recorte));
+    sumarEtiqueta(etiqueta, 0 - (getBlockSize(level) - recorte));
+    if (recorte) sumar(bytesRecortados, 0 - recorte);
+    sumar(bytesSolicitados, 0 - solicitado);
+}
+
+char* BuddyAllocator::allocNucleo(int level) {
+    // En modo NUMA sólo se usan (y se crean) arenas del nodo del hilo
+    int nodo = numaLocal ? nodoHiloActual() : -1;
+    int n = numArenas.load(std::memory_order_relaxed);
+    for (int i = 0; i < n; ++i) {
+        if (numaLocal && arenas[i]->nodo != nodo) continue;
+        char* b = allocEnArena(arenas[i], level);
+        if (b) return b;
+    }
+
+    // Con fusión diferida puede haber pares de buddies libres sin fusionar
+    if (marcaDiferida) {
+        for (int i = 0; i < n; ++i) {
+            if (numaLocal && arenas[i]->nodo != nodo) continue;
+            if (!fusionarDiferidos(arenas[i])) continue;
+            char* b = allocEnArena(arenas[i], level);
+            if (b) return b;
+        }
+    }
+
+    // Ninguna arena puede: se mapea otra con su propio árbol buddy
+    if (crecer && level < MAX_LEVELS) {
+        Arena* nueva = crearArena(std::max(tamArenaBase, getBlockSize(level)), nodo);
+        if (nueva) return allocEnArena(nueva, level);
+    }
+
+    // Sin poder crecer, antes que fallar se acepta memoria de otro nodo
+    if (numaLocal) {
+        for (int i = 0; i < n; ++i) {
+            if (arenas[i]->nodo == nodo) continue;
+            char* b = allocEnArena(arenas[i], level);
+            if (b) return b;
+        }
+    }
+    return nullptr;
+}
+
+char* BuddyAllocator::allocEnArena(Arena* a, int level) {
+    // Primer nivel >= level con bloques libres, sin recorrer listas vacías
+    if (level >= a->numLevels) return nullptr;
+    uint64_t candidatos = a->nivelesConBloques >> level;
+    if (!candidatos) return nullptr;
+
+    int l = level + __builtin_ctzll(candidatos);
+    size_t off = sacarLibre(a, l);
+
     // Splitea hasta alcanzar el nivel deseado
     while (l > level) {
-        if (!split(l)) {
-            std::cerr << "Error: fallo en la división de bloques\n";
-            return nullptr;
-        }
+        split(a, off, l);
         --l;
     }
 
-    Block* block = freeLists[level];
-    freeLists[level] = block->next;
-    block->size = size;
-    allocatedBlocks[block] = level;
+    // El nivel queda escrito para que free() no dependa de quién lo pidió
+    MetaBloque* m = metaDe(a, a->base() + off);
+    m->nivel = level;
+    m->compuesto = 0;
+    return a->base() + off;
+}
 
-    return static_cast<void*>(
-        static_cast<char*>(static_cast<void*>(block)) + sizeof(Block)
-    );
+bool BuddyAllocator::freeNucleo(Arena* a, char* blockPtr) {
+    size_t off = blockPtr - a->base();
+    MetaBloque* m = metaDe(a, blockPtr);
+
+    if (m->compuesto) {
+        // Se validan todas las piezas antes de liberar ninguna
+        size_t offs[MAX_LEVELS];
+        int niveles[MAX_LEVELS];
+        int level = m->nivel;
+        int n = level < a->numLevels
+                    ? piezasCompuesto(off, level, necesarioDe(m->solicitado), offs, niveles)
+                    : 0;
+        bool valido = n > 0;
+        for (int i = 0; i < n && valido; ++i) valido = piezaValida(a, offs[i], niveles[i]);
+        if (!valido) {
+            std::cerr << "Error: intento de liberar un puntero no asignado\n";
+            return false;
+        }
+        m->asignado = 0;
+        m->compuesto = 0;
+        for (int i = 0; i < n; ++i) liberarPieza(a, offs[i], niveles[i]);
+        return true;
+    }
+
+    size_t level = m->nivel;
+    if (!piezaValida(a, off, level)) {
+        std::cerr << "Error: intento de liberar un puntero no asignado\n";
+        return false;
+    }
+    m->asignado = 0;
+    liberarPieza(a, off, static_cast<int>(level));
+    return true;
 }
 
-void BuddyAllocator::free(void* ptr) {
-    if (!ptr) return;
-    void* blockPtr = static_cast<char*>(ptr) - sizeof(Block);
-    auto it = allocatedBlocks.find(blockPtr);
-    if (it == allocatedBlocks.end()) {
+// El nivel de la cabecera sólo se acepta si los bitmaps lo confirman:
+// bloque alineado a su tamaño, ni libre ni dividido, y con el padre dividido.
+bool BuddyAllocator::piezaValida(Arena* a, size_t off, size_t level) const {
+    return level < static_cast<size_t>(a->numLevels) &&
+           off % getBlockSize(level) == 0 &&
+           !leerBit(a, a->bitsLibre(), off, level) &&
+           !leerBit(a, a->bitsDividido(), off, level) &&
+           (static_cast<int>(level) == a->numLevels - 1 ||
+            leerBit(a, a->bitsDividido(), off, level + 1));
+}
+
+void BuddyAllocator::liberarPieza(Arena* a, size_t off, int level) {
+    if (a->cuentaLibres[level] < marcaDiferida) {
+        sumar(contDiferidos, 1);
+        insertarLibre(a, off, level);
+    } else {
+        coalesce(a, off, level);
+    }
+}
+
+size_t BuddyAllocator::necesarioDe(size_t size) {
+    return std::max(size, MIN_BLOCK_SIZE);
+}
+
+// Piezas que ocupa una reserva compuesta: se baja por el árbol desde el bloque
+// original; si lo que falta cabe en la mitad izquierda se descarta la derecha,
+// si no la izquierda se queda entera y se sigue por la derecha. Se para cuando
+// la cola sin usar es menor que un gránulo.
+int BuddyAllocator::piezasCompuesto(size_t off, int level, size_t necesario,
+                                    size_t* offs, int* niveles) const {
+    int n = 0;
+    size_t resto = necesario;
+    while (level > NIVEL_GRANULO && getBlockSize(level) - resto >= TAM_GRANULO) {
+        size_t mitad = getBlockSize(level - 1);
+        --level;
+        if (resto > mitad) {
+            offs[n] = off;
+            niveles[n++] = level;
+            off += mitad;
+            resto -= mitad;
+        }
+    }
+    offs[n] = off;
+    niveles[n++] = level;
+    return n;
+}
+
+// Mismo recorrido que piezasCompuesto, dividiendo de verdad: las mitades
+// descartadas quedan en las listas libres. Devuelve los bytes devueltos.
+// Las mitades que se conservan no pasan por la lista libre: al encoger en
+// sitio contienen datos del usuario y el nodo libre los pisaría.
+size_t BuddyAllocator::recortarCola(Arena* a, size_t off, int level, size_t necesario) {
+    size_t devuelto = 0;
+    size_t resto = necesario;
+    while (level > NIVEL_GRANULO && getBlockSize(level) - resto >= TAM_GRANULO) {
+        size_t mitad = getBlockSize(level - 1);
+        sumar(contSplits, 1);
+        ponerBit(a, a->bitsDividido(), off, level, true);
+        --level;
+        if (resto > mitad) {
+            off += mitad;
+            resto -= mitad;
+        } else {
+            insertarLibre(a, off + mitad, level);
+            devuelto += mitad;
+        }
+    }
+    return devuelto;
+}
+
+char* BuddyAllocator::allocCompuesto(int level, size_t necesario, size_t& recorte) {
+    std::unique_lock<CerrojoNucleo> guard(cerrojo, std::defer_lock);
+    if (concurrente) guard.lock();
+
+    char* b = allocNucleo(level);
+    if (!b) return nullptr;
+    Arena* a = arenaDe(b);
+    recorte = recortarCola(a, b - a->base(), level, necesario);
+    if (recorte) metaDe(a, b)->compuesto = 1;
+    return b;
+}
+
+BuddyAllocator::Cargador* BuddyAllocator::cargadorDe(int hilo, int level) const {
+    return &cargadores[hilo * NIVELES_CACHE + level];
+}
+
+char* BuddyAllocator::allocConcurrente(int level) {
+    int hilo = cargadores ? ranuraHiloActual() : -1;
+    if (level >= NIVELES_CACHE || hilo < 0) {
+        std::lock_guard<CerrojoNucleo> guard(cerrojo);
+        return allocNucleo(level);
+    }
+
+    // Cargador vacío: se rellena con un lote bajo un único cerrojo
+    Cargador* c = cargadorDe(hilo, level);
+    if (c->cuenta == 0) {
+        std::lock_guard<CerrojoNucleo> guard(cerrojo);
+        while (c->cuenta < LOTE_CARGADOR) {
+            char* b = allocNucleo(level);
+            if (!b) break;
+            c->bloques[c->cuenta++] = b;
+        }
+        if (c->cuenta == 0) return nullptr;
+    }
+    return static_cast<char*>(c->bloques[--c->cuenta]);
+}
+
+bool BuddyAllocator::freeConcurrente(Arena* a, char* blockPtr) {
+    MetaBloque* m = metaDe(a, blockPtr);
+    size_t level = m->compuesto ? MAX_LEVELS : m->nivel;
+    int hilo = cargadores ? ranuraHiloActual() : -1;
+    // Los bloques cacheados no pasan por los bitmaps: sólo se comprueba que el
+    // nivel sea coherente con la alineación; la validación completa se hace al vaciar.
+    if (level >= static_cast<size_t>(NIVELES_CACHE) || hilo < 0 ||
+        (blockPtr - a->base()) % getBlockSize(level) != 0) {
+        std::lock_guard<CerrojoNucleo> guard(cerrojo);
+        return freeNucleo(a, blockPtr);
+    }
+
+    // Cargador lleno: se devuelve al núcleo la mitad más antigua
+    Cargador* c = cargadorDe(hilo, level);
+    if (c->cuenta == CAPACIDAD_CARGADOR) {
+        std::lock_guard<CerrojoNucleo> guard(cerrojo);
+        for (int i = 0; i < LOTE_CARGADOR; ++i) {
+            char* b = static_cast<char*>(c->bloques[i]);
+            freeNucleo(arenaDe(b), b);
+        }
+        std::memmove(c->bloques, c->bloques + LOTE_CARGADOR,
+                     (CAPACIDAD_CARGADOR - LOTE_CARGADOR) * sizeof(void*));
+        c->cuenta -= LOTE_CARGADOR;
+    }
+    m->asignado = 0;
+    c->bloques[c->cuenta++] = blockPtr;
+    return true;
+}
+
+void BuddyAllocator::vaciarCacheHilo() {
+    int hilo = cargadores ? ranuraHiloActual() : -1;
+    if (hilo < 0) return;
+
+    std::lock_guard<CerrojoNucleo> guard(cerrojo);
+    for (int l = 0; l < NIVELES_CACHE; ++l) {
+        Cargador* c = cargadorDe(hilo, l);
+        while (c->cuenta > 0) {
+            char* b = static_cast<char*>(c->bloques[--c->cuenta]);
+            freeNucleo(arenaDe(b), b);
+        }
+    }
+}
+
+// Clases de 16 en 16 hasta 64 bytes y después dos por potencia de 2
+// (1.5 * 2^k y 2^(k+1)): el hueco interno no pasa de un tercio del objeto
+int BuddyAllocator::claseSlab(size_t size) {
+    if (size <= 64) return size <= MIN_OBJETO_SLAB ? 0 : static_cast<int>((size + 15) / 16) - 1;
+    int k = 63 - __builtin_clzll(size - 1);  // 2^k < size <= 2^(k+1)
+    int base = 4 + 2 * (k - 6);
+    return size <= (size_t(3) << (k - 1)) ? base : base + 1;
+}
+
+size_t BuddyAllocator::tamClase(int clase) {
+    if (clase < 4) return MIN_OBJETO_SLAB * (clase + 1);
+    size_t potencia = size_t(64) << ((clase - 4) / 2);
+    return clase % 2 == 0 ? potencia + potencia / 2 : 2 * potencia;
+}
+
+// Los objetos de una clase quedan alineados a la mayor potencia de 2 que
+// divide su tamaño (los slabs empiezan en un múltiplo de 16 KB de la arena)
+bool BuddyAllocator::sirveSlab(size_t size, size_t alineacion) const {
+    if (!slabs || size > MAX_OBJETO_SLAB) return false;
+    size_t tam = tamClase(claseSlab(size));
+    return alineacion <= (tam & (~tam + 1));
+}
+
+// El slab de un objeto es el bloque de TAM_SLAB que lo contiene, si su
+// entrada en la tabla lateral está asignada y marcada como slab
+BuddyAllocator::Slab* BuddyAllocator::slabDe(Arena* a, const void* ptr) const {
+    if (!slabs || !a || a->tamano < TAM_SLAB) return nullptr;
+    size_t off = static_cast<const char*>(ptr) - a->base();
+    char* inicio = a->base() + (off & ~(TAM_SLAB - 1));
+    MetaBloque* m = metaDe(a, inicio);
+    if (!m->asignado || !m->slab) return nullptr;
+    return reinterpret_cast<Slab*>(inicio + TAM_SLAB) - 1;
+}
+
+BuddyAllocator::Slab* BuddyAllocator::nuevoSlab(int clase) {
+    char* inicio = static_cast<char*>(allocInterno(TAM_SLAB, TAM_SLAB, EtiquetaMemoria::Pequenos));
+    if (!inicio) return nullptr;
+    metaDe(arenaDe(inicio), inicio)->slab = 1;
+
+    Slab* s = reinterpret_cast<Slab*>(inicio + TAM_SLAB) - 1;
+    s->clase = clase;
+    s->tamObjeto = static_cast<uint32_t>(tamClase(clase));
+    s->capacidad = static_cast<uint32_t>((TAM_SLAB - sizeof(Slab)) / s->tamObjeto);
+    s->usados = 0;
+    s->virgenes = 0;
+    s->libres = nullptr;
+    std::memset(s->ocupados, 0, sizeof(s->ocupados));
+
+    ClaseSlab& c = clasesSlab[clase];
+    s->ant = nullptr;
+    s->sig = c.parciales;
+    if (c.parciales) c.parciales->ant = s;
+    c.parciales = s;
+    ++c.slabs;
+    return s;
+}
+
+// Se llama con el cerrojo de la clase tomado (en modo concurrente)
+void BuddyAllocator::soltarSlab(Slab* s) {
+    ClaseSlab& c = clasesSlab[s->clase];
+    if (s->ant) s->ant->sig = s->sig;
+    else c.parciales = s->sig;
+    if (s->sig) s->sig->ant = s->ant;
+    --c.slabs;
+
+    char* inicio = s->inicio();
+    metaDe(arenaDe(inicio), inicio)->slab = 0;
+    freeInterno(inicio);
+}
+
+void* BuddyAllocator::allocSlab(size_t size) {
+    int clase = claseSlab(size);
+    ClaseSlab& c = clasesSlab[clase];
+    std::unique_lock<std::mutex> guard(c.cerrojo, std::defer_lock);
+    if (concurrente) guard.lock();
+
+    Slab* s = c.parciales;
+    if (!s && !(s = nuevoSlab(clase))) return nullptr;
+
+    char* obj;
+    if (s->libres) {
+        obj = static_cast<char*>(s->libres);
+        s->libres = *reinterpret_cast<void**>(obj);
+    } else {
+        obj = s->inicio() + size_t(s->virgenes++) * s->tamObjeto;
+    }
+    size_t i = (obj - s->inicio()) / s->tamObjeto;
+    s->ocupados[i / 64] |= 1ULL << (i % 64);
+
+    // Lleno: sale de la lista hasta que se libere un objeto
+    if (++s->usados == s->capacidad) {
+        c.parciales = s->sig;
+        if (s->sig) s->sig->ant = nullptr;
+    }
+    ++c.objetos;
+    sumar(contAllocsSlab, 1);
+    return obj;
+}
+
+bool BuddyAllocator::freeSlab(Slab* s, void* ptr) {
+    ClaseSlab& c = clasesSlab[s->clase];
+    std::unique_lock<std::mutex> guard(c.cerrojo, std::defer_lock);
+    if (concurrente) guard.lock();
+
+    size_t rel = static_cast<char*>(ptr) - s->inicio();
+    size_t i = rel / s->tamObjeto;
+    if (rel % s->tamObjeto != 0 || i >= s->virgenes || !(s->ocupados[i / 64] & (1ULL << (i % 64)))) {
         std::cerr << "Error: intento de liberar un puntero no asignado\n";
-        return;
+        return false;
+    }
+    s->ocupados[i / 64] &= ~(1ULL << (i % 64));
+    *static_cast<void**>(ptr) = s->libres;
+    s->libres = ptr;
+
+    // Estaba lleno: vuelve a la lista
+    if (s->usados-- == s->capacidad) {
+        s->ant = nullptr;
+        s->sig = c.parciales;
+        if (c.parciales) c.parciales->ant = s;
+        c.parciales = s;
+    }
+    --c.objetos;
+    sumar(contFreesSlab, 1);
+
+    // Vacío: se devuelve al núcleo salvo que sea el único con hueco de su
+    // clase (así un objeto que se reserva y libera en bucle no rehace el slab)
+    if (s->usados == 0 && (c.parciales != s || s->sig)) soltarSlab(s);
+    return true;
+}
+
+// Los slabs sólo se conservan vacíos si son el último de su clase; trim los
+// devuelve también, antes de tomar el cerrojo del núcleo (van a liberarse a él)
+size_t BuddyAllocator::liberarSlabsVacios() {
+    if (!slabs) return 0;
+    size_t liberados = 0;
+    for (ClaseSlab& c : clasesSlab) {
+        std::unique_lock<std::mutex> guard(c.cerrojo, std::defer_lock);
+        if (concurrente) guard.lock();
+        for (Slab* s = c.parciales; s;) {
+            Slab* sig = s->sig;
+            if (s->usados == 0) {
+                soltarSlab(s);
+                ++liberados;
+            }
+            s = sig;
+        }
+    }
+    return liberados;
+}
+
+size_t BuddyAllocator::trim() {
+    liberarSlabsVacios();
+    std::unique_lock<CerrojoNucleo> guard(cerrojo, std::defer_lock);
+    if (concurrente) guard.lock();
+    size_t devuelto = 0;
+    int n = numArenas.load(std::memory_order_relaxed);
+    for (int i = 0; i < n; ++i) {
+        fusionarDiferidos(arenas[i]);
+        if (devolverDesde) devuelto += devolverLibres(arenas[i]);
+    }
+    sumar(contTrims, 1);
+    sumar(bytesDevueltos, devuelto);
+    return devuelto;
+}
+
+// Cada bloque libre de devolverDesde bytes o más se devuelve una sola vez
+// (NodoLibre::devuelto); al salir de la lista libre el nodo desaparece y el
+// bloque vuelve a contar como residente en cuanto se toque. La primera página
+// se conserva porque guarda el nodo; con páginas grandes el rango se ajusta a
+// 2 MB para no partirlas.
+size_t BuddyAllocator::devolverLibres(Arena* a) {
+    bool paginasNormales = a->respaldo == RESPALDO_NORMAL || a->respaldo == RESPALDO_COMPARTIDO;
+    size_t pagina = paginasNormales ? TAM_PAGINA : TAM_PAGINA_GRANDE;
+    int consejo = MADV_DONTNEED;
+#ifdef MADV_FREE
+    // hugetlbfs no admite MADV_FREE
+    if (devolucionPerezosa && a->respaldo != RESPALDO_HUGETLB) consejo = MADV_FREE;
+#endif
+    // En memoria compartida MADV_DONTNEED sólo quita el mapeo de este
+    // proceso; MADV_REMOVE libera las páginas del objeto
+    if (a->respaldo == RESPALDO_COMPARTIDO) consejo = MADV_REMOVE;
+
+    size_t devuelto = 0;
+    for (int level = getLevel(devolverDesde); level < a->numLevels; ++level) {
+        for (size_t off = a->freeLists[level]; off != NIL; off = nodo(a, off)->next) {
+            NodoLibre* n = nodo(a, off);
+            if (n->devuelto) continue;
+            uintptr_t ini = reinterpret_cast<uintptr_t>(a->base() + off) + sizeof(NodoLibre);
+            ini = (ini + pagina - 1) & ~(pagina - 1);
+            uintptr_t fin = reinterpret_cast<uintptr_t>(a->base() + off) + getBlockSize(level);
+            fin &= ~(pagina - 1);
+            if (ini >= fin) continue;
+            if (madvise(reinterpret_cast<void*>(ini), fin - ini, consejo) != 0) continue;
+            n->devuelto = 1;
+            devuelto += fin - ini;
+        }
+    }
+    return devuelto;
+}
+
+void BuddyAllocator::bucleTrim(std::chrono::milliseconds intervalo) {
+    std::unique_lock<std::mutex> guard(cerrojoTrim);
+    while (!avisoTrim.wait_for(guard, intervalo, [this] { return pararTrim; })) {
+        trim();
+    }
+}
+
+BuddyEstadisticas BuddyAllocator::getStats() const {
+    BuddyEstadisticas e{};
+    e.tamMinBloque = MIN_BLOCK_SIZE;
+
+    {
+        std::unique_lock<CerrojoNucleo> guard(cerrojo, std::defer_lock);
+        if (concurrente) guard.lock();
+        e.numArenas = getNumArenas();
+        for (int i = 0; i < e.numArenas; ++i) {
+            Arena* a = arenas[i];
+            e.bytesReservados += a->tamano;
+            e.numNiveles = std::max(e.numNiveles, a->numLevels);
+            for (int l = 0; l < a->numLevels; ++l) {
+                e.bloquesLibres[l] += a->cuentaLibres[l];
+                e.bytesLibres += a->cuentaLibres[l] * getBlockSize(l);
+            }
+            if (a->nivelesConBloques) {
+                int top = 63 - __builtin_clzll(a->nivelesConBloques);
+                e.bloqueMaximoLibre = std::max(e.bloqueMaximoLibre, getBlockSize(top));
+            }
+        }
+    }
+
+    // mincore no necesita el cerrojo: las arenas no se desmapean en vida del allocator
+    for (int i = 0; i < e.numArenas; ++i) {
+        e.bytesResidentes += medirResidentes(arenas[i]->base(), arenas[i]->tamano);
+    }
+
+    e.bytesEnUso = bytesEnUso.load(std::memory_order_relaxed);
+    // Compartido: los contadores son de este proceso, pero un bloque puede
+    // reservarse en uno y liberarse en otro; lo ocupado se mide en el segmento
+    if (esCompartido()) e.bytesEnUso = e.bytesReservados - e.bytesLibres;
+    e.bytesSolicitados = bytesSolicitados.load(std::memory_order_relaxed);
+    e.picoBytesEnUso = picoBytesEnUso.load(std::memory_order_relaxed);
+    for (int i = 0; i < BuddyEstadisticas::NUM_ETIQUETAS; ++i) {
+        e.bytesPorEtiqueta[i] = bytesEtiqueta[i].load(std::memory_order_relaxed);
+        e.picoPorEtiqueta[i] = picoEtiqueta[i].load(std::memory_order_relaxed);
+    }
+    e.conLatencias = latencias != nullptr;
+    for (int op = 0; latencias && op < BuddyEstadisticas::NUM_OPERACIONES_LATENCIA; ++op) {
+        uint64_t total[CUBETAS_LATENCIA] = {};
+        uint64_t maximoTotal = 0;
+        for (int l = 0; l < BuddyEstadisticas::MAX_NIVELES; ++l) {
+            uint64_t cubetas[CUBETAS_LATENCIA];
+            for (int c = 0; c < CUBETAS_LATENCIA; ++c) {
+                cubetas[c] = latencias->cubetas[op][l][c].load(std::memory_order_relaxed);
+                total[c] += cubetas[c];
+            }
+            uint64_t maximo = latencias->maximo[op][l].load(std::memory_order_relaxed);
+            maximoTotal = std::max(maximoTotal, maximo);
+            e.latenciaPorNivel[op][l] = resumirLatencia(cubetas, maximo);
+        }
+        e.latenciaTotal[op] = resumirLatencia(total, maximoTotal);
+    }
+    size_t ocupados = e.bytesReservados - e.bytesLibres;
+    e.bytesEnCargadores = ocupados > e.bytesEnUso ? ocupados - e.bytesEnUso : 0;
+
+    e.fragmentacionInterna = e.bytesEnUso ? 1.0 - double(e.bytesSolicitados) / e.bytesEnUso : 0.0;
+    e.fragmentacionExterna = e.bytesLibres ? 1.0 - double(e.bloqueMaximoLibre) / e.bytesLibres : 0.0;
+    e.bytesRecortados = bytesRecortados.load(std::memory_order_relaxed);
+    size_t enUsoPotencia2 = e.bytesEnUso + e.bytesRecortados;
+    e.fragmentacionInternaPotencia2 =
+        enUsoPotencia2 ? 1.0 - double(e.bytesSolicitados) / enUsoPotencia2 : 0.0;
+
+    e.allocs = contAllocs.load(std::memory_order_relaxed);
+    e.frees = contFrees.load(std::memory_order_relaxed);
+    e.splits = contSplits.load(std::memory_order_relaxed);
+    e.coalesces = contCoalesces.load(std::memory_order_relaxed);
+    e.fallos = contFallos.load(std::memory_order_relaxed);
+    e.freesDiferidos = contDiferidos.load(std::memory_order_relaxed);
+    e.compuestos = contCompuestos.load(std::memory_order_relaxed);
+    e.trims = contTrims.load(std::memory_order_relaxed);
+    e.bytesDevueltos = bytesDevueltos.load(std::memory_order_relaxed);
+
+    e.allocsSlab = contAllocsSlab.load(std::memory_order_relaxed);
+    e.freesSlab = contFreesSlab.load(std::memory_order_relaxed);
+    if (slabs) {
+        e.clasesSlab = NUM_CLASES_SLAB;
+        for (int i = 0; i < NUM_CLASES_SLAB; ++i) {
+            ClaseSlab& c = const_cast<ClaseSlab&>(clasesSlab[i]);
+            std::unique_lock<std::mutex> guard(c.cerrojo, std::defer_lock);
+            if (concurrente) guard.lock();
+            e.tamClaseSlab[i] = tamClase(i);
+            e.slabsPorClase[i] = c.slabs;
+            e.objetosPorClase[i] = c.objetos;
+            e.slabs += c.slabs;
+            e.objetosSlab += c.objetos;
+            e.bytesObjetosSlab += c.objetos * tamClase(i);
+        }
+    }
+
+    EstadoScratch s = estadoScratch();
+    e.buffersScratch = s.buffers;
+    e.bytesScratch = s.bytes;
+    e.scratchReusos = s.reusos;
+    e.scratchReservas = s.reservas;
+    return e;
+}
+
+const char* BuddyEstadisticas::nombreOperacion(int operacion) {
+    static const char* nombres[NUM_OPERACIONES_LATENCIA] = {"alloc", "free", "split", "coalesce"};
+    return operacion >= 0 && operacion < NUM_OPERACIONES_LATENCIA ? nombres[operacion] : "?";
+}
+
+static void latenciaJson(std::ostringstream& o, const BuddyEstadisticas::Latencia& l) {
+    o << "\"muestras\":" << l.muestras << ",\"p50\":" << l.p50 << ",\"p99\":" << l.p99
+      << ",\"max\":" << l.max;
+}
+
+std::string BuddyEstadisticas::aJson() const {
+    std::ostringstream o;
+    o << "{\"arenas\":" << numArenas
+      << ",\"bytes_reservados\":" << bytesReservados
+      << ",\"bytes_residentes\":" << bytesResidentes
+      << ",\"bytes_libres\":" << bytesLibres
+      << ",\"bytes_en_uso\":" << bytesEnUso
+      << ",\"bytes_solicitados\":" << bytesSolicitados
+      << ",\"bytes_en_cargadores\":" << bytesEnCargadores
+      << ",\"pico_bytes_en_uso\":" << picoBytesEnUso
+      << ",\"bloque_maximo_libre\":" << bloqueMaximoLibre
+      << ",\"fragmentacion_interna\":" << fragmentacionInterna
+      << ",\"fragmentacion_externa\":" << fragmentacionExterna
+      << ",\"fragmentacion_interna_potencia2\":" << fragmentacionInternaPotencia2
+      << ",\"bytes_recortados\":" << bytesRecortados
+      << ",\"allocs\":" << allocs
+      << ",\"frees\":" << frees
+      << ",\"splits\":" << splits
+      << ",\"coalesces\":" << coalesces
+      << ",\"fallos\":" << fallos
+      << ",\"frees_diferidos\":" << freesDiferidos
+      << ",\"compuestos\":" << compuestos
+      << ",\"trims\":" << trims
+      << ",\"bytes_devueltos\":" << bytesDevueltos
+      << ",\"buffers_scratch\":" << buffersScratch
+      << ",\"bytes_scratch\":" << bytesScratch
+      << ",\"scratch_reusos\":" << scratchReusos
+      << ",\"scratch_reservas\":" << scratchReservas
+      << ",\"slabs\":" << slabs
+      << ",\"objetos_slab\":" << objetosSlab
+      << ",\"bytes_objetos_slab\":" << bytesObjetosSlab
+      << ",\"allocs_slab\":" << allocsSlab
+      << ",\"frees_slab\":" << freesSlab
+      << ",\"clases_slab\":[";
+    for (int i = 0; i < clasesSlab; ++i) {
+        o << (i ? "," : "") << "{\"tam\":" << tamClaseSlab[i] << ",\"slabs\":" << slabsPorClase[i]
+          << ",\"objetos\":" << objetosPorClase[i] << "}";
+    }
+    o << "],\"etiquetas\":[";
+    bool primera = true;
+    for (int i = 0; i < NUM_ETIQUETAS; ++i) {
+        if (!picoPorEtiqueta[i]) continue;
+        o << (primera ? "" : ",") << "{\"etiqueta\":\""
+          << nombreEtiqueta(static_cast<EtiquetaMemoria>(i)) << "\",\"bytes\":" << bytesPorEtiqueta[i]
+          << ",\"pico\":" << picoPorEtiqueta[i] << "}";
+        primera = false;
+    }
+    o << "],\"bloques_libres\":[";
+    for (int l = 0; l < numNiveles; ++l) {
+        o << (l ? "," : "") << "{\"tam\":" << (tamMinBloque << l)
+          << ",\"libres\":" << bloquesLibres[l] << "}";
+    }
+    o << "]";
+    if (conLatencias) {
+        o << ",\"latencias_ciclos\":{";
+        for (int op = 0; op < NUM_OPERACIONES_LATENCIA; ++op) {
+            o << (op ? "," : "") << "\"" << nombreOperacion(op) << "\":{";
+            latenciaJson(o, latenciaTotal[op]);
+            o << ",\"niveles\":[";
+            bool primero = true;
+            for (int l = 0; l < MAX_NIVELES; ++l) {
+                if (!latenciaPorNivel[op][l].muestras) continue;
+                o << (primero ? "" : ",") << "{\"tam\":" << (tamMinBloque << l) << ",";
+                latenciaJson(o, latenciaPorNivel[op][l]);
+                o << "}";
+                primero = false;
+            }
+            o << "]}";
+        }
+        o << "}";
+    }
+    o << "}";
+    return o.str();
+}
+
+void BuddyAllocator::printStatus() const {
+    BuddyEstadisticas e = getStats();
+    const double MB = 1024.0 * 1024.0;
+
+    std::cout << "=== ESTADO DEL BUDDY ALLOCATOR ===\n";
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "Arenas: " << e.numArenas << " (" << e.bytesReservados / MB << " MB reservados, "
+              << e.bytesResidentes / MB << " MB residentes)\n";
+    std::cout << "En uso: " << e.bytesEnUso / MB << " MB (solicitados "
+              << e.bytesSolicitados / MB << " MB, pico " << e.picoBytesEnUso / MB << " MB)\n";
+    std::cout << "Libres: " << e.bytesLibres / MB << " MB, mayor bloque "
+              << e.bloqueMaximoLibre / MB << " MB";
+    if (e.bytesEnCargadores) std::cout << ", en cargadores " << e.bytesEnCargadores / MB << " MB";
+    std::cout << "\n";
+    std::cout << "Fragmentación interna: " << e.fragmentacionInterna * 100 << " %, externa: "
+              << e.fragmentacionExterna * 100 << " %\n";
+    if (e.compuestos) {
+        std::cout << "Reservas compuestas: " << e.compuestos << ", colas devueltas "
+                  << e.bytesRecortados / MB << " MB (interna sin compuestas: "
+                  << e.fragmentacionInternaPotencia2 * 100 << " %)\n";
+    }
+    std::cout << "Operaciones: " << e.allocs << " alloc, " << e.frees << " free, "
+              << e.splits << " split, " << e.coalesces << " coalesce, "
+              << e.fallos << " fallos";
+    if (e.freesDiferidos) std::cout << ", " << e.freesDiferidos << " frees diferidos";
+    std::cout << "\n";
+    if (e.trims) {
+        std::cout << "Trim: " << e.trims << " llamadas, " << e.bytesDevueltos / MB
+                  << " MB devueltos al sistema\n";
+    }
+    if (e.buffersScratch) {
+        std::cout << "Buffers de trabajo: " << e.buffersScratch << " (" << e.bytesScratch / MB
+                  << " MB), " << e.scratchReusos << " reusos, " << e.scratchReservas
+                  << " reservas\n";
+    }
+    bool conEtiquetas = false;
+    for (int i = 1; i < BuddyEstadisticas::NUM_ETIQUETAS; ++i) conEtiquetas |= e.picoPorEtiqueta[i] != 0;
+    if (conEtiquetas) {
+        std::cout << "Por etiqueta (actual / pico):\n";
+        for (int i = 0; i < BuddyEstadisticas::NUM_ETIQUETAS; ++i) {
+            if (!e.picoPorEtiqueta[i]) continue;
+            std::cout << "  " << std::setw(14) << nombreEtiqueta(static_cast<EtiquetaMemoria>(i))
+                      << ": " << e.bytesPorEtiqueta[i] / MB << " / " << e.picoPorEtiqueta[i] / MB
+                      << " MB\n";
+        }
+    }
+    if (e.allocsSlab) {
+        std::cout << "Slabs: " << e.slabs << " (" << e.slabs * TAM_SLAB / MB << " MB), "
+                  << e.objetosSlab << " objetos (" << e.bytesObjetosSlab / 1024.0 << " KB), "
+                  << e.allocsSlab << " alloc, " << e.freesSlab << " free\n";
+        for (int i = 0; i < e.clasesSlab; ++i) {
+            if (!e.slabsPorClase[i]) continue;
+            std::cout << "  " << std::setw(12) << e.tamClaseSlab[i] << " B: " << e.slabsPorClase[i]
+                      << " slabs, " << e.objetosPorClase[i] << " objetos\n";
+        }
     }
-    int level = it->second;
-    allocatedBlocks.erase(it);
-    coalesce(blockPtr, level);
+    if (e.conLatencias) {
+        std::cout << "Latencias (ciclos; p50 y p99 redondeados a potencia de 2):\n";
+        std::cout << "  " << std::setw(8) << "op" << std::setw(14) << "bloque" << std::setw(12)
+                  << "muestras" << std::setw(10) << "p50" << std::setw(10) << "p99"
+                  << std::setw(12) << "max" << "\n";
+        for (int op = 0; op < BuddyEstadisticas::NUM_OPERACIONES_LATENCIA; ++op) {
+            for (int l = -1; l < BuddyEstadisticas::MAX_NIVELES; ++l) {
+                const BuddyEstadisticas::Latencia& lat =
+                    l < 0 ? e.latenciaTotal[op] : e.latenciaPorNivel[op][l];
+                if (!lat.muestras) continue;
+                std::cout << "  " << std::setw(8) << BuddyEstadisticas::nombreOperacion(op);
+                if (l < 0) std::cout << std::setw(14) << "total";
+                else std::cout << std::setw(12) << (e.tamMinBloque << l) << " B";
+                std::cout << std::setw(12) << lat.muestras << std::setw(10) << lat.p50
+                          << std::setw(10) << lat.p99 << std::setw(12) << lat.max << "\n";
+            }
+        }
+    }
+    std::cout << "Bloques libres por nivel:\n";
+    for (int l = 0; l < e.numNiveles; ++l) {
+        if (!e.bloquesLibres[l]) continue;
+        std::cout << "  " << std::setw(12) << (e.tamMinBloque << l) << " B: "
+                  << e.bloquesLibres[l] << "\n";
+    }
+    std::cout << std::defaultfloat << std::setprecision(6);
 }
 
 void* BuddyAllocator::realloc(void* ptr, size_t newSize) {
     if (!ptr) return alloc(newSize);
     if (newSize == 0) { free(ptr); return nullptr; }
 
-    Block* block = reinterpret_cast<Block*>(static_cast<char*>(ptr) - sizeof(Block));
-    if (newSize <= block->size) return ptr;
+    void* newPtr = reallocInterno(ptr, newSize);
+    if (trazaFd >= 0) registrarTraza(TRAZA_REALLOC, newSize, newPtr, ptr);
+    return newPtr;
+}
 
-    void* newPtr = alloc(newSize);
+void* BuddyAllocator::reallocInterno(void* ptr, size_t newSize) {
+    Arena* a = arenaDe(ptr);
+    // Un objeto pequeño se queda si cabe en su clase; si no, se mueve (a
+    // otra clase o al núcleo)
+    if (Slab* s = a ? slabDe(a, ptr) : nullptr) {
+        size_t tam = s->tamObjeto;
+        if (newSize <= tam) return ptr;
+        void* newPtr = sirveSlab(newSize, MIN_OBJETO_SLAB)
+                           ? allocSlab(newSize)
+                           : allocInterno(newSize, MIN_BLOCK_SIZE, etiquetaHiloActual());
+        if (!newPtr) return nullptr;
+        std::memcpy(newPtr, ptr, tam);
+        freeSlab(s, ptr);
+        return newPtr;
+    }
+    if (!a || !metaDe(a, ptr)->asignado) {
+        std::cerr << "Error: realloc de un puntero no asignado\n";
+        return nullptr;
+    }
+    if (reallocEnSitio(a, static_cast<char*>(ptr), newSize)) return ptr;
+
+    // Una compuesta que no pudo recomponerse sigue sirviendo si cabe
+    MetaBloque* m = metaDe(a, ptr);
+    if (newSize <= huellaBloque(*m)) return ptr;
+
+    // El bloque nuevo mantiene la alineación que tenía el anterior
+    size_t alineacion = std::min(getBlockSize(m->nivel), ALINEACION_MAXIMA);
+    // En una compuesta que no se recompuso puede haber en uso más de lo anotado
+    size_t copiar = m->compuesto ? huellaBloque(*m) : m->solicitado;
+    // y su etiqueta: el bloque sigue siendo de la misma etapa
+    void* newPtr = allocInterno(newSize, alineacion, static_cast<EtiquetaMemoria>(m->etiqueta));
     if (!newPtr) return nullptr;
-    std::memcpy(newPtr, ptr, block->size);
-    free(ptr);
+    std::memcpy(newPtr, ptr, copiar);
+    freeInterno(ptr);
     return newPtr;
 }
 
-void* BuddyAllocator::getCache(size_t size) {
-    if (cacheMemory && cacheSize >= size) return cacheMemory;
-    if (cacheMemory) std::free(cacheMemory);
-    cacheSize = size;
-    cacheMemory = std::aligned_alloc(64, size);
-    return cacheMemory;
+bool BuddyAllocator::reallocEnSitio(Arena* a, char* blockPtr, size_t newSize) {
+    std::unique_lock<CerrojoNucleo> guard(cerrojo, std::defer_lock);
+    if (concurrente) guard.lock();
+
+    MetaBloque* m = metaDe(a, blockPtr);
+    MetaBloque antes = *m;
+    size_t off = blockPtr - a->base();
+
+    if (newSize <= m->solicitado) {
+        encoger(a, off, m, newSize);
+    } else if (!crecerEnSitio(a, off, m, newSize)) {
+        // Los buddies pueden estar libres pero troceados por la fusión diferida
+        if (!marcaDiferida || !fusionarDiferidos(a) || !crecerEnSitio(a, off, m, newSize)) {
+            return false;
+        }
+    }
+    registrarCambio(antes, *m);
+    return true;
+}
+
+// Encoger siempre es posible: se dividen las mitades finales del bloque y se
+// devuelven a las listas. No se baja de un gránulo (4 KB): por debajo el
+// ahorro no compensa y así se conserva la alineación de allocAligned.
+void BuddyAllocator::encoger(Arena* a, size_t off, MetaBloque* m, size_t newSize) {
+    if (m->compuesto) {
+        encogerCompuesto(a, off, m->nivel, necesarioDe(m->solicitado), necesarioDe(newSize));
+    } else if (compuestos && newSize >= MIN_COMPUESTO) {
+        if (recortarCola(a, off, m->nivel, necesarioDe(newSize))) m->compuesto = 1;
+    } else {
+        int level = m->nivel;
+        int destino = std::max(getLevel(newSize), NIVEL_GRANULO);
+        while (level > destino) {
+            split(a, off, level);
+            --level;
+        }
+        m->nivel = level;
+    }
+    m->solicitado = newSize;
+}
+
+// Crecer sin mover: el bloque tiene que ser la mitad izquierda en cada nivel
+// hasta el destino y los buddies de la derecha estar libres y enteros. Una
+// compuesta se reensambla antes si todas sus colas siguen libres. Se
+// comprueba todo antes de tocar nada.
+bool BuddyAllocator::crecerEnSitio(Arena* a, size_t off, MetaBloque* m, size_t newSize) {
+    int level = m->nivel;
+    if (!m->compuesto && newSize <= getBlockSize(level)) {
+        m->solicitado = newSize;
+        return true;
+    }
+
+    int destino = std::max(getLevel(newSize), level);
+    if (destino >= a->numLevels || off % getBlockSize(destino) != 0) return false;
+    if (m->compuesto && !colaLibre(a, off, level, necesarioDe(m->solicitado))) return false;
+    for (int l = level; l < destino; ++l) {
+        if (!leerBit(a, a->bitsLibre(), off + getBlockSize(l), l)) return false;
+    }
+
+    if (m->compuesto) reensamblar(a, off, level, necesarioDe(m->solicitado));
+    for (int l = level; l < destino; ++l) {
+        quitarLibre(a, off + getBlockSize(l), l);
+        ponerBit(a, a->bitsDividido(), off, l + 1, false);
+        sumar(contCoalesces, 1);
+    }
+    m->nivel = destino;
+    m->compuesto = 0;
+    if (compuestos && newSize >= MIN_COMPUESTO && recortarCola(a, off, destino, necesarioDe(newSize))) {
+        m->compuesto = 1;
+    }
+    m->solicitado = newSize;
+    return true;
 }
 
-void BuddyAllocator::releaseCache() {
-    if (cacheMemory) {
-        std::free(cacheMemory);
-        cacheMemory = nullptr;
-        cacheSize = 0;
+// Recorre a la vez las piezas del tamaño actual y del nuevo (ver
+// piezasCompuesto). Mientras coinciden no hay nada que hacer; donde el nuevo
+// baja por la izquierda y el actual seguía por la derecha, las piezas de la
+// derecha se liberan y la mitad izquierda se recorta al tamaño nuevo.
+void BuddyAllocator::encogerCompuesto(Arena* a, size_t off, int level, size_t necesario,
+                                      size_t nuevo) {
+    while (level > NIVEL_GRANULO && getBlockSize(level) - necesario >= TAM_GRANULO) {
+        size_t mitad = getBlockSize(level - 1);
+        --level;
+        if (necesario <= mitad) continue;
+        if (nuevo > mitad) {
+            off += mitad;
+            necesario -= mitad;
+            nuevo -= mitad;
+            continue;
+        }
+
+        size_t offs[MAX_LEVELS];
+        int niveles[MAX_LEVELS];
+        int n = piezasCompuesto(off + mitad, level, necesario - mitad, offs, niveles);
+        for (int i = 0; i < n; ++i) liberarPieza(a, offs[i], niveles[i]);
+        recortarCola(a, off, level, nuevo);
+        return;
     }
+    // La última pieza del tamaño actual es un bloque entero: se recorta
+    recortarCola(a, off, level, nuevo);
 }
 
-void* BuddyAllocator::buddyOf(void* ptr, int level) const {
-    size_t blockSize = getBlockSize(level);
-    size_t offsetBytes = offset(ptr);
-    size_t buddyOffset = offsetBytes ^ blockSize;
-    return static_cast<char*>(memoryBase) + buddyOffset;
+// true si todas las colas que devolvió la compuesta siguen libres y enteras
+bool BuddyAllocator::colaLibre(Arena* a, size_t off, int level, size_t necesario) const {
+    while (level > NIVEL_GRANULO && getBlockSize(level) - necesario >= TAM_GRANULO) {
+        size_t mitad = getBlockSize(level - 1);
+        --level;
+        if (necesario > mitad) {
+            off += mitad;
+            necesario -= mitad;
+        } else if (!leerBit(a, a->bitsLibre(), off + mitad, level)) {
+            return false;
+        }
+    }
+    return true;
 }
 
-size_t BuddyAllocator::offset(void* ptr) const {
-    return static_cast<char*>(ptr) - static_cast<char*>(memoryBase);
+// Inversa de recortarCola: recupera las colas y deshace las divisiones, de
+// modo que la compuesta vuelve a ser un único bloque de su nivel original
+void BuddyAllocator::reensamblar(Arena* a, size_t off, int level, size_t necesario) {
+    while (level > NIVEL_GRANULO && getBlockSize(level) - necesario >= TAM_GRANULO) {
+        size_t mitad = getBlockSize(level - 1);
+        ponerBit(a, a->bitsDividido(), off, level, false);
+        --level;
+        if (necesario > mitad) {
+            off += mitad;
+            necesario -= mitad;
+        } else {
+            quitarLibre(a, off + mitad, level);
+        }
+    }
 }
 
-// <-- Aquí cambiamos void por bool y añadimos retornos true/false -->
-bool BuddyAllocator::split(int level) {
-    Block* block = freeLists[level];
-    if (!block) return false;
+bool BuddyAllocator::iniciarTraza(const char* ruta) {
+    std::lock_guard<std::mutex> guard(cerrojoTraza);
+    if (trazaFd >= 0) return false;
 
-    freeLists[level] = block->next;
-    size_t halfSize = getBlockSize(level - 1);
+    int fd = open(ruta, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        std::cerr << "Error: no se pudo abrir la traza '" << ruta << "'\n";
+        return false;
+    }
 
-    // Asegurarnos de no salirnos del pool
-    Block* second = reinterpret_cast<Block*>(
-        reinterpret_cast<char*>(block) + halfSize
-    );
-    if (reinterpret_cast<char*>(second) + sizeof(Block)
-        > reinterpret_cast<char*>(memoryBase) + totalSize) {
-        // devolvemos el bloque original
-        block->next = freeLists[level];
-        freeLists[level] = block;
+    // El buffer se mapea una vez por traza, fuera del pool y del heap
+    void* m = mmap(nullptr, CAPACIDAD_TRAZA * sizeof(RegistroTraza), PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (m == MAP_FAILED) {
+        close(fd);
         return false;
     }
 
-    Block* first = block;
-    first->next = nullptr;
-    second->next = nullptr;
-    first->size  = halfSize - sizeof(Block);
-    second->size = halfSize - sizeof(Block);
+    CabeceraTraza cab;
+    std::memcpy(cab.magia, MAGIA_TRAZA, sizeof(cab.magia));
+    cab.version = VERSION_TRAZA;
+    cab.tamRegistro = sizeof(RegistroTraza);
+    cab.reservado = 0;
+    if (write(fd, &cab, sizeof(cab)) != static_cast<ssize_t>(sizeof(cab))) {
+        munmap(m, CAPACIDAD_TRAZA * sizeof(RegistroTraza));
+        close(fd);
+        return false;
+    }
 
-    freeLists[level - 1] = first;
-    first->next = second;
+    trazaBuffer = static_cast<RegistroTraza*>(m);
+    trazaCuenta = 0;
+    trazaInicio = std::chrono::steady_clock::now();
+    trazaFd = fd;
     return true;
 }
 
-void BuddyAllocator::coalesce(void* ptr, int level) {
-    void* buddy = buddyOf(ptr, level);
+void BuddyAllocator::detenerTraza() {
+    std::lock_guard<std::mutex> guard(cerrojoTraza);
+    if (trazaFd < 0) return;
+    volcarTraza();
+    close(trazaFd);
+    munmap(trazaBuffer, CAPACIDAD_TRAZA * sizeof(RegistroTraza));
+    trazaBuffer = nullptr;
+    trazaFd = -1;
+}
+
+void BuddyAllocator::registrarTraza(OpTraza op, size_t size, void* id, void* idPrevio) {
+    auto ahora = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> guard(cerrojoTraza, std::defer_lock);
+    if (concurrente) guard.lock();
+    if (trazaFd < 0) return;
 
-    Block** curr = &freeLists[level];
-    while (*curr) {
-        if (*curr == buddy) {
-            *curr = (*curr)->next;
-            void* base = std::min(ptr, buddy);
-            coalesce(base, level + 1);
-            return;
+    RegistroTraza& r = trazaBuffer[trazaCuenta++];
+    r.tiempoNs = std::chrono::duration_cast<std::chrono::nanoseconds>(ahora - trazaInicio).count();
+    r.id = reinterpret_cast<uintptr_t>(id);
+    r.idPrevio = reinterpret_cast<uintptr_t>(idPrevio);
+    r.tamOp = empaquetarTamOp(op, size);
+    if (trazaCuenta == CAPACIDAD_TRAZA) volcarTraza();
+}
+
+void BuddyAllocator::volcarTraza() {
+    size_t bytes = trazaCuenta * sizeof(RegistroTraza);
+    const char* p = reinterpret_cast<const char*>(trazaBuffer);
+    while (bytes > 0) {
+        ssize_t n = write(trazaFd, p, bytes);
+        if (n <= 0) {
+            std::cerr << "Error: no se pudo escribir la traza\n";
+            break;
         }
-        curr = &((*curr)->next);
+        p += n;
+        bytes -= n;
+    }
+    trazaCuenta = 0;
+}
+
+size_t BuddyAllocator::capacidad(const void* ptr) const {
+    Arena* a = arenaDe(ptr);
+    if (Slab* s = slabDe(a, ptr)) return s->tamObjeto;
+    return huellaBloque(*metaDe(a, ptr));
+}
+
+size_t BuddyAllocator::huellaBloque(const MetaBloque& m) const {
+    if (!m.compuesto) return getBlockSize(m.nivel);
+
+    size_t offs[MAX_LEVELS];
+    int niveles[MAX_LEVELS];
+    int n = piezasCompuesto(0, m.nivel, necesarioDe(m.solicitado), offs, niveles);
+    size_t total = 0;
+    for (int i = 0; i < n; ++i) total += getBlockSize(niveles[i]);
+    return total;
+}
+
+size_t BuddyAllocator::buddyOf(size_t off, int level) const {
+    return off ^ getBlockSize(level);
+}
+
+// Divide el bloque (ya fuera de la lista) en off/level: la mitad derecha pasa
+// a la lista del nivel inferior y la izquierda queda para el llamador.
+void BuddyAllocator::split(Arena* a, size_t off, int level) {
+    uint64_t inicio = 0;
+    if constexpr (MEDIR_LATENCIAS) inicio = leerCiclos();
+    sumar(contSplits, 1);
+    ponerBit(a, a->bitsDividido(), off, level, true);
+    insertarLibre(a, off + getBlockSize(level - 1), level - 1);
+    if constexpr (MEDIR_LATENCIAS) anotarLatencia(BuddyEstadisticas::LAT_SPLIT, level, inicio);
+}
+
+// Fusiona iterativamente con el buddy mientras éste esté libre. Consultar el
+// bitmap y desenlazar el buddy es O(1); ya no se recorre la lista del nivel.
+void BuddyAllocator::coalesce(Arena* a, size_t off, int level) {
+    uint64_t inicio = 0;
+    if constexpr (MEDIR_LATENCIAS) inicio = leerCiclos();
+    int nivelInicial = level;
+    while (level < a->numLevels - 1) {
+        size_t buddy = buddyOf(off, level);
+        if (!leerBit(a, a->bitsLibre(), buddy, level)) break;
+
+        quitarLibre(a, buddy, level);
+        sumar(contCoalesces, 1);
+        off = std::min(off, buddy);
+        ++level;
+        ponerBit(a, a->bitsDividido(), off, level, false);
+    }
+    insertarLibre(a, off, level);
+    if constexpr (MEDIR_LATENCIAS) {
+        anotarLatencia(BuddyEstadisticas::LAT_COALESCE, nivelInicial, inicio);
     }
+}
 
-    Block* block = static_cast<Block*>(ptr);
-    block->next = freeLists[level];
-    freeLists[level] = block;
+// Recorre los niveles de abajo arriba fusionando cada bloque libre cuyo buddy
+// también lo esté; coalesce sube tanto como pueda, así que basta una pasada.
+bool BuddyAllocator::fusionarDiferidos(Arena* a) {
+    bool fusiono = false;
+    for (int level = 0; level < a->numLevels - 1; ++level) {
+        size_t off = a->freeLists[level];
+        while (off != NIL) {
+            size_t sig = nodo(a, off)->next;
+            size_t buddy = buddyOf(off, level);
+            if (leerBit(a, a->bitsLibre(), buddy, level)) {
+                // coalesce desenlaza al buddy: si era el siguiente, se salta
+                if (sig == buddy) sig = nodo(a, buddy)->next;
+                quitarLibre(a, off, level);
+                coalesce(a, off, level);
+                fusiono = true;
+            }
+            off = sig;
+        }
+    }
+    return fusiono;
 }
 
 bool BuddyAllocator::isAligned(void* ptr, size_t alignment) const {
     return (reinterpret_cast<uintptr_t>(ptr) % alignment) == 0;
 }
+
+BuddyAllocator::MetaBloque* BuddyAllocator::metaDe(Arena* a, const void* blockPtr) const {
+    return &a->metas()[(static_cast<const char*>(blockPtr) - a->base()) / MIN_BLOCK_SIZE];
+}
+
+BuddyAllocator::NodoLibre* BuddyAllocator::nodo(Arena* a, size_t off) const {
+    return reinterpret_cast<NodoLibre*>(a->base() + off);
+}
+
+void BuddyAllocator::insertarLibre(Arena* a, size_t off, int level) {
+    NodoLibre* n = nodo(a, off);
+    n->prev = NIL;
+    n->next = a->freeLists[level];
+    n->devuelto = 0;
+    if (a->freeLists[level] != NIL) nodo(a, a->freeLists[level])->prev = off;
+    a->freeLists[level] = off;
+    a->cuentaLibres[level]++;
+    a->nivelesConBloques |= 1ULL << level;
+    ponerBit(a, a->bitsLibre(), off, level, true);
+}
+
+void BuddyAllocator::quitarLibre(Arena* a, size_t off, int level) {
+    NodoLibre* n = nodo(a, off);
+    if (n->prev != NIL) nodo(a, n->prev)->next = n->next;
+    else a->freeLists[level] = n->next;
+    if (n->next != NIL) nodo(a, n->next)->prev = n->prev;
+    a->cuentaLibres[level]--;
+    if (a->freeLists[level] == NIL) a->nivelesConBloques &= ~(1ULL << level);
+    ponerBit(a, a->bitsLibre(), off, level, false);
+}
+
+size_t BuddyAllocator::sacarLibre(Arena* a, int level) {
+    size_t off = a->freeLists[level];
+    quitarLibre(a, off, level);
+    return off;
+}
+
+size_t BuddyAllocator::indiceBloque(size_t off, int level) const {
+    return off >> (MIN_BLOCK_SHIFT + level);
+}
+
+bool BuddyAllocator::leerBit(Arena* a, const uint64_t* bits, size_t off, int level) const {
+    size_t i = indiceBloque(off, level);
+    return (bits[a->inicioBits[level] + i / 64] >> (i % 64)) & 1;
+}
+
+void BuddyAllocator::ponerBit(Arena* a, uint64_t* bits, size_t off, int level, bool valor) {
+    size_t i = indiceBloque(off, level);
+    uint64_t& palabra = bits[a->inicioBits[level] + i / 64];
+    if (valor) palabra |= 1ULL << (i % 64);
+    else palabra &= ~(1ULL << (i % 64));
+}
@@ -2,50 +2,563 @@
 #ifndef BUDDY_ALLOCATOR_H
 #define BUDDY_ALLOCATOR_H
 
+#include "buddy_traza.h"
+#include "image_allocator.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <cstddef>
-#include <vector>
-#include <unordered_map>
+#include <cstdint>
+#include <mutex>
+#include <pthread.h>
+#include <string>
+#include <thread>
 
-class BuddyAllocator {
+// Respaldo físico de las arenas
+enum class RespaldoPool {
+    Normal,          // Páginas de 4 KB
+    PaginasGrandes   // MAP_HUGETLB; si no hay páginas reservadas, madvise(MADV_HUGEPAGE)
+};
+
+// Páginas físicas de las arenas al crearlas
+enum class PrecargaPool {
+    Ninguna,      // El núcleo las asigna (y rellena de ceros) en el primer acceso
+    MapPopulate,  // mmap con MAP_POPULATE
+    Paralela      // Varios hilos escriben una vez en cada página
+};
+
+// Opciones de construcción del allocator
+struct BuddyOpciones {
+    // Modo seguro para hilos: cada hilo guarda en cargadores propios los
+    // bloques pequeños liberados recientemente y sólo toma el cerrojo del
+    // núcleo buddy al rellenar o vaciar un cargador.
+    bool concurrente = false;
+
+    // Si ninguna arena puede servir una petición se mapea otra nueva, del
+    // tamaño de la inicial o mayor si la petición no cabe en ella.
+    bool crecer = true;
+
+    // Páginas grandes para reducir fallos de TLB en buffers de 100+ MB
+    RespaldoPool respaldo = RespaldoPool::Normal;
+
+    // Una arena por nodo NUMA: cada petición se sirve (o hace crecer el pool)
+    // en el nodo del hilo que la hace, y las arenas se ligan a ese nodo.
+    bool numaLocal = false;
+
+    // Prefault: el coste de los fallos de página se paga al crear cada arena
+    // en lugar de en el primer memcpy/memset de cada imagen. Con numaLocal o
+    // páginas grandes, MapPopulate se hace como Paralela: la política del
+    // nodo y MADV_HUGEPAGE tienen que aplicarse antes de asignar las páginas.
+    PrecargaPool precarga = PrecargaPool::Ninguna;
+
+    // Fusión diferida (lazy buddy): al liberar, el bloque se queda en la lista
+    // de su nivel sin fusionarse con su buddy mientras ese nivel tenga menos
+    // de marcaDiferida bloques libres. Los diferidos se fusionan al fallar una
+    // reserva o con trim(). 0 = fusión inmediata.
+    size_t marcaDiferida = 0;
+
+    // Reservas compuestas: las peticiones de 1 MB o más se sirven con una
+    // secuencia contigua de bloques buddy (p. ej. 8 MB + 4 MB para 12 MB) y
+    // la cola sobrante del bloque potencia de 2 vuelve a las listas libres.
+    bool compuestos = false;
+
+    // trim() devuelve al sistema (madvise) las páginas de los bloques libres
+    // de al menos devolverDesde bytes; se conserva la primera página de cada
+    // bloque, que guarda su nodo de la lista libre. 0 = trim sólo fusiona.
+    size_t devolverDesde = 1024 * 1024;
+
+    // MADV_FREE en lugar de MADV_DONTNEED: el núcleo sólo recupera las
+    // páginas si le hacen falta, y si el bloque se reutiliza antes no hay
+    // fallos de página. El RSS no baja hasta que hay presión de memoria.
+    bool devolucionPerezosa = false;
+
+    // Un hilo de fondo llama a trim() con este periodo (0 = sólo trim manual).
+    // Como trim compite con las reservas, activa también el modo concurrente.
+    std::chrono::milliseconds intervaloTrim{0};
+
+    // Cachés de slabs: las peticiones de hasta 2048 bytes se sirven desde
+    // bloques de 16 KB del núcleo cortados en objetos de una clase de tamaño
+    // (16, 32, 48, 64, 96, 128... 1536, 2048), sin ocupar cada una un bloque
+    // de 64 bytes o más del árbol. Esos objetos se alinean a 16 bytes (a su
+    // clase si es potencia de 2); allocAligned con más alineación va al núcleo.
+    bool slabs = false;
+
+    // Pool compartido entre procesos: la arena se mapea MAP_SHARED sobre un
+    // objeto de memoria compartida y el cerrojo del núcleo es un
+    // pthread_mutex_t PTHREAD_PROCESS_SHARED guardado en el propio segmento.
+    // Como los metadatos de la arena son desplazamientos, cada proceso puede
+    // mapearla en otra dirección; los bloques se pasan entre procesos con
+    // desplazamientoDe/punteroDe. Con nombreCompartido se usa shm_open (si el
+    // objeto ya existe, el allocator se adjunta a él e ignora el tamaño
+    // pedido); con fdCompartido, un memfd o shm ya abierto (vacío = crearlo);
+    // con sólo compartido, un memfd_create nuevo que heredan los hijos de fork.
+    // El pool compartido tiene una sola arena (no crece), sin cargadores por
+    // hilo ni slabs, con páginas normales y fuera de NUMA.
+    bool compartido = false;
+    std::string nombreCompartido;
+    int fdCompartido = -1;
+
+    // Pool persistente: el mismo segmento que el compartido, pero sobre un
+    // fichero normal que sobrevive al proceso. Si el fichero ya contiene un
+    // pool, el allocator se adjunta a él (con su tamaño, no el pedido) y los
+    // bloques publicados en el índice (ver publicarEnIndice) siguen ahí, así
+    // que un proceso que se reinicia recupera lo que dejó el anterior. Quien
+    // lo abre sin otros procesos adjuntos lo revisa: si el índice no cuadra
+    // con los bloques ocupados (un proceso murió entre alloc y publicar, o a
+    // medio cambio) el pool se vacía. Los datos sobreviven a reiniciar el
+    // proceso; a un apagado, sólo si el núcleo llegó a escribir las páginas.
+    std::string archivoPersistente;
+};
+
+// Fotografía del estado del allocator (ver BuddyAllocator::getStats)
+struct BuddyEstadisticas {
+    static const int MAX_NIVELES = 40;
+    static const int MAX_CLASES_SLAB = 14;
+
+    int numArenas;
+    int numNiveles;                          // Niveles del árbol más alto
+    size_t tamMinBloque;                     // Bytes de un bloque de nivel 0
+    size_t bloquesLibres[MAX_NIVELES];       // Bloques en las listas libres, por nivel
+
+    size_t bytesReservados;                  // Suma de las arenas
+    size_t bytesResidentes;                  // Páginas de las arenas en memoria física (un mincore por arena)
+    size_t bytesLibres;                      // En las listas libres del núcleo
+    size_t bytesEnUso;                       // Bloques entregados al usuario
+    size_t bytesSolicitados;                 // Lo que el usuario pidió de esos bloques
+    size_t bytesEnCargadores;                // Bloques libres retenidos por hilos
+    size_t picoBytesEnUso;                   // Máximo histórico de bytesEnUso
+    size_t bloqueMaximoLibre;                // Mayor bloque servible sin crecer
+
+    double fragmentacionInterna;             // 1 - solicitados / enUso
+    double fragmentacionExterna;             // 1 - bloqueMaximoLibre / bytesLibres
+    double fragmentacionInternaPotencia2;    // La interna si no hubiera reservas compuestas
+    size_t bytesRecortados;                  // Colas devueltas por las compuestas vivas
+
+    uint64_t allocs;
+    uint64_t frees;
+    uint64_t splits;
+    uint64_t coalesces;
+    uint64_t fallos;                         // Peticiones que no se pudieron servir
+    uint64_t freesDiferidos;                 // Frees que no intentaron fusionar
+    uint64_t compuestos;                     // Reservas servidas como compuestas
+    uint64_t trims;                          // Llamadas a trim (manuales o del hilo de fondo)
+    size_t bytesDevueltos;                   // Acumulado que trim pasó a madvise
+
+    int buffersScratch;                      // Buffers de trabajo vivos (getScratch)
+    size_t bytesScratch;                     // Bloques que ocupan (incluidos en bytesEnUso)
+    uint64_t scratchReusos;                  // getScratch servidos sin reservar
+    uint64_t scratchReservas;                // getScratch que tuvieron que reservar
+
+    // Slabs (ver BuddyOpciones::slabs). Cada slab cuenta en allocs y
+    // bytesEnUso como un bloque del núcleo; sus objetos se cuentan aparte.
+    size_t slabs;                            // Bloques del núcleo cortados en objetos
+    uint64_t objetosSlab;                    // Objetos pequeños entregados ahora
+    size_t bytesObjetosSlab;                 // Lo que ocupan según su clase
+    uint64_t allocsSlab;
+    uint64_t freesSlab;
+    int clasesSlab;                          // Entradas válidas de los arrays por clase
+    size_t tamClaseSlab[MAX_CLASES_SLAB];
+    size_t slabsPorClase[MAX_CLASES_SLAB];
+    uint64_t objetosPorClase[MAX_CLASES_SLAB];
+
+    // Por etiqueta del sitio de reserva (ver EtiquetaMemoria): bytes que
+    // ocupan ahora los bloques del núcleo y su máximo histórico
+    static const int NUM_ETIQUETAS = static_cast<int>(EtiquetaMemoria::Cuenta);
+    size_t bytesPorEtiqueta[NUM_ETIQUETAS];
+    size_t picoPorEtiqueta[NUM_ETIQUETAS];
+
+    // Latencias en ciclos del núcleo, sólo compilando buddy_allocator.cpp con
+    // BUDDY_LATENCIAS (ver BuddyAllocator::latenciasCompiladas). Los
+    // percentiles salen de un histograma log2: son la cota superior de su
+    // cubeta (como mucho el doble del valor real); el máximo es exacto.
+    enum OperacionLatencia { LAT_ALLOC, LAT_FREE, LAT_SPLIT, LAT_COALESCE, NUM_OPERACIONES_LATENCIA };
+    struct Latencia {
+        uint64_t muestras;
+        uint64_t p50;
+        uint64_t p99;
+        uint64_t max;
+    };
+    bool conLatencias;
+    Latencia latenciaTotal[NUM_OPERACIONES_LATENCIA];               // Todos los niveles
+    Latencia latenciaPorNivel[NUM_OPERACIONES_LATENCIA][MAX_NIVELES];
+    static const char* nombreOperacion(int operacion);
+
+    std::string aJson() const;
+};
+
+// Motor Buddy System indexado por bitmaps.
+// El pool se compone de arenas: regiones mapeadas con su propio árbol buddy,
+// cuyo nivel máximo se deduce del tamaño de la arena. Todos los metadatos
+// (bitmaps de bloques libres/divididos por nivel y las listas libres
+// doblemente enlazadas) viven dentro de cada arena: alloc/free no llaman
+// nunca a malloc y su coste está acotado por el número de niveles. Los
+// bloques no llevan cabecera: su nivel y tamaño solicitado se guardan en una
+// tabla lateral de la arena, así que cada puntero devuelto es el inicio de un
+// bloque y queda alineado a min(tamaño del bloque, 4 KB). La
+// versión anterior se conserva como BuddyAllocatorClasico
+// (buddy_allocator_clasico.h) para comparar.
+// Las llamadas sobre un BuddyAllocator concreto no pasan por la tabla virtual
+// de ImageAllocator (la clase es final).
+class BuddyAllocator final : public ImageAllocator {
 public:
-    explicit BuddyAllocator(size_t totalSize);
+    explicit BuddyAllocator(size_t totalSize, const BuddyOpciones& opciones = BuddyOpciones());
     ~BuddyAllocator();
 
-    void* alloc(size_t size);
-    void free(void* ptr);
-    void* realloc(void* ptr, size_t newSize);
-    
-    // Cache de memoria para operaciones repetitivas
-    void* getCache(size_t size);
-    void releaseCache();
+    const char* nombre() const override { return "buddy"; }
+
+    void* alloc(size_t size) override;         // Alineado al menos a 64 bytes (16 desde un slab)
+    // Potencia de 2 <= ALINEACION_MAXIMA (las arenas empiezan en página)
+    void* allocAligned(size_t size, size_t alignment) override;
+    // Con etiqueta explícita; las de arriba usan la del hilo (AmbitoEtiqueta).
+    // Un objeto de slab no lleva la suya: su slab entero cuenta como Pequenos
+    void* alloc(size_t size, EtiquetaMemoria etiqueta);
+    void* allocAligned(size_t size, size_t alignment, EtiquetaMemoria etiqueta);
+    void free(void* ptr) override;
+    // Sin mover el bloque siempre que se pueda: al crecer absorbe los buddies
+    // libres de la derecha y al encoger devuelve las mitades finales. Si hay
+    // que mover, conserva la alineación (hasta 4 KB)
+    void* realloc(void* ptr, size_t newSize) override;
+
+    // Devuelve al núcleo los bloques cacheados por el hilo llamador
+    // (sólo tiene efecto en modo concurrente)
+    void vaciarCacheHilo();
+
+    // Fusiona todos los bloques libres cuyo buddy también esté libre
+    // (los que dejó la fusión diferida, ver BuddyOpciones::marcaDiferida) y
+    // devuelve al sistema las páginas de los bloques libres grandes
+    // (ver BuddyOpciones::devolverDesde). Antes devuelve al núcleo los slabs
+    // vacíos. Devuelve los bytes liberados.
+    size_t trim() override;
+
+    // true si ptr cae dentro de alguna arena del pool
+    bool contiene(const void* ptr) const override { return arenaDe(ptr) != nullptr; }
+    size_t capacidad(const void* ptr) const override;  // Bytes útiles del bloque de ptr
+
+    // Pool compartido (ver BuddyOpciones::compartido). El desplazamiento de un
+    // bloque es el mismo en todos los procesos adjuntos al segmento.
+    static const uint64_t SIN_DESPLAZAMIENTO = ~0ULL;
+    bool esCompartido() const { return fdSegmento >= 0; }
+    int getFdCompartido() const { return fdSegmento; }      // -1 si es privado
+    uint64_t desplazamientoDe(const void* ptr) const;       // SIN_DESPLAZAMIENTO si no es del pool
+    void* punteroDe(uint64_t desplazamiento) const;          // nullptr si no cae en el pool
+    static bool eliminarCompartido(const char* nombre);      // shm_unlink
+
+    // Índice de bloques con nombre en la cabecera del segmento (sólo pools
+    // compartidos o persistentes): otro proceso, o éste tras reiniciarse,
+    // encuentra un bloque por su clave. Publicar no copia nada; el bloque
+    // sigue ocupado hasta que alguien lo retira del índice y lo libera.
+    static const int MAX_ENTRADAS_INDICE = 30;
+    static const size_t MAX_CLAVE_INDICE = 96;      // Con el '\0'
+    struct EntradaIndice {
+        char clave[MAX_CLAVE_INDICE];               // Vacía = entrada libre
+        uint64_t desplazamiento;                    // Del bloque en la arena
+        uint64_t secuencia;                         // Orden de publicación
+        uint32_t datos[4];                          // Para quien publica (ancho, alto...)
+    };
+    // false si la clave ya está, el índice está lleno o ptr no es un bloque
+    // entregado por este pool
+    bool publicarEnIndice(const char* clave, const void* ptr, const uint32_t* datos = nullptr);
+    void* buscarEnIndice(const char* clave, EntradaIndice* entrada = nullptr) const;
+    void* retirarDelIndice(const char* clave);       // El bloque, para liberarlo
+    int leerIndice(EntradaIndice* salida, int max) const;  // Copia las entradas ocupadas
 
     // Métodos para diagnóstico
-    size_t getTotalSize() const { return totalSize; }
-    void printStatus() const; // Método para imprimir estado del allocator
+    size_t getTotalSize() const { return totalSize.load(std::memory_order_relaxed); }
+    int getNumArenas() const { return numArenas.load(std::memory_order_acquire); }
+    const char* getRespaldo(int arena = 0) const; // "hugetlb", "thp" o "normal"
+    int getNodoArena(int arena = 0) const;       // -1 si la arena no está ligada
+    void printStatus() const override; // Método para imprimir estado del allocator
+    std::string estadisticasJson() const override { return getStats().aJson(); }
+
+    // Traza opcional de alloc/free/realloc en formato binario (buddy_traza.h)
+    // para reproducirla offline con bench/replay_traza. Desactivada sólo
+    // cuesta una comparación por operación.
+    bool iniciarTraza(const char* ruta);
+    void detenerTraza();
+
+    // Contadores relajados: se pueden consultar en producción sin detener a
+    // los hilos que reservan; los totales de las listas se leen bajo el cerrojo.
+    BuddyEstadisticas getStats() const;
+
+    // true si este buddy_allocator.o mide latencias (make LATENCIAS=1): alloc
+    // y free del núcleo por nivel del bloque, cada split por el nivel que se
+    // divide y cada coalesce por el nivel desde el que empieza a fusionar. Los
+    // objetos de slab no pasan por ahí. Sin la macro no se compila ninguna
+    // medida y la disposición de la clase no cambia.
+    static bool latenciasCompiladas();
 
 private:
     static const size_t MIN_BLOCK_SIZE = 64;  // Incrementado para mejor rendimiento
-    static const int MAX_LEVELS = 20;
+    static const int MIN_BLOCK_SHIFT = 6;     // log2(MIN_BLOCK_SIZE)
+    static const int MAX_LEVELS = 40;         // Tope absoluto; cada arena usa log2(tamaño/64)+1
+    static const int MAX_ARENAS = 32;
+    static const uint64_t NIL = ~0ULL;        // Fin de lista (los enlaces son offsets)
+    static const size_t TAM_PAGINA = 4096;
+    static const size_t TAM_PAGINA_GRANDE = 2 * 1024 * 1024;
+    static_assert(BuddyEstadisticas::MAX_NIVELES >= MAX_LEVELS,
+                  "BuddyEstadisticas debe cubrir todos los niveles");
+
+    // Cargadores por hilo del modo concurrente
+    static const int MAX_HILOS = 64;          // Hilos con cargador propio
+    static const int NIVELES_CACHE = 13;      // Niveles cacheados (bloques <= 256 KB)
+    static const int CAPACIDAD_CARGADOR = 16;
+    static const int LOTE_CARGADOR = 8;       // Bloques movidos por relleno/vaciado
+
+    static const size_t CAPACIDAD_TRAZA = 4096;  // Registros en memoria antes de volcar
+
+    // Reservas compuestas (ver BuddyOpciones::compuestos)
+    static const size_t MIN_COMPUESTO = 1024 * 1024;  // Peticiones más pequeñas no se recortan
+    static const size_t TAM_GRANULO = 4096;           // Pieza mínima de una compuesta
+    static const int NIVEL_GRANULO = 6;               // log2(TAM_GRANULO / MIN_BLOCK_SIZE)
 
-    struct Block {
-        Block* next;
-        size_t size;  // Tamaño real del bloque
+    // Slabs (ver BuddyOpciones::slabs)
+    static const int NUM_CLASES_SLAB = BuddyEstadisticas::MAX_CLASES_SLAB;
+    static const size_t MAX_OBJETO_SLAB = 2048;
+    static const int NIVEL_SLAB = 8;                  // Slabs de 16 KB
+    static const size_t TAM_SLAB = MIN_BLOCK_SIZE << NIVEL_SLAB;
+    static const size_t MIN_OBJETO_SLAB = 16;
+
+    // Metadatos de un bloque asignado, en la tabla lateral de su arena (una
+    // entrada por cada MIN_BLOCK_SIZE bytes; sólo se usa la del inicio del
+    // bloque). La tabla se mapea con la arena y sólo ocupa memoria física en
+    // las páginas que se llegan a tocar.
+    struct MetaBloque {
+        uint64_t solicitado : 48;  // Tamaño pedido por el usuario
+        uint64_t nivel : 6;        // Se valida contra los bitmaps en free; en una
+                                   // compuesta, nivel del bloque potencia de 2 original
+        uint64_t compuesto : 1;    // Reserva compuesta (ver BuddyOpciones::compuestos)
+        uint64_t asignado : 1;     // Entregado al usuario (detecta dobles free)
+        uint64_t slab : 1;         // Bloque cortado en objetos pequeños (ver Slab)
+        uint64_t etiqueta : 4;     // EtiquetaMemoria con la que se reservó
+        uint64_t reservado : 3;
+    };
+    static_assert(sizeof(MetaBloque) == 8, "MetaBloque debe ocupar 8 bytes");
+    static_assert(BuddyEstadisticas::NUM_ETIQUETAS <= 16, "La etiqueta ocupa 4 bits en MetaBloque");
+
+    // Nodo de la lista libre, escrito dentro del propio bloque libre.
+    // Se usan offsets respecto a la base de la arena en lugar de punteros.
+    struct NodoLibre {
+        uint64_t prev;
+        uint64_t next;
+        uint64_t devuelto;  // trim ya devolvió sus páginas al sistema
     };
 
-    void* memoryBase;
-    size_t totalSize;
-    Block* freeLists[MAX_LEVELS];
-    std::unordered_map<void*, int> allocatedBlocks;  // Mapeo de punteros a niveles
-    void* cacheMemory;
-    size_t cacheSize;
+    // Metadatos de una arena. Se escriben justo detrás de su árbol buddy y van
+    // seguidos de los bitmaps y de la tabla de MetaBloque; todo se localiza
+    // relativo a la propia estructura.
+    struct Arena {
+        size_t tamano;                     // Bytes del árbol buddy (potencia de 2)
+        size_t tamMapeo;                   // Bytes mapeados (árbol + metadatos)
+        int numLevels;                     // log2(tamano / MIN_BLOCK_SIZE) + 1
+        uint64_t nivelesConBloques;        // Bit L activo si freeLists[L] no está vacía
+        uint64_t freeLists[MAX_LEVELS];    // Offset del primer bloque libre de cada nivel
+        size_t inicioBits[MAX_LEVELS];     // Primera palabra de cada nivel en los bitmaps
+        size_t palabrasBits;               // Palabras de cada bitmap
+        int respaldo;                      // Cómo se obtuvo la memoria (ver getRespaldo)
+        int nodo;                          // Nodo NUMA al que se ligó, o -1
+        size_t cuentaLibres[MAX_LEVELS];   // Longitud de cada lista libre
+
+        char* base() { return reinterpret_cast<char*>(this) - tamano; }
+        uint64_t* bitsLibre() { return reinterpret_cast<uint64_t*>(this + 1); }
+        uint64_t* bitsDividido() { return bitsLibre() + palabrasBits; }
+        MetaBloque* metas() { return reinterpret_cast<MetaBloque*>(bitsDividido() + palabrasBits); }
+        bool contiene(const void* p) {
+            return p >= base() && p < static_cast<const void*>(this);
+        }
+    };
+
+    // Cabecera de un slab, al final de su bloque para que los objetos empiecen
+    // en el inicio (alineados a su clase si es potencia de 2). Los objetos
+    // nunca entregados se reparten por desplazamiento; los devueltos forman
+    // una lista enlazada dentro de ellos mismos. El bitmap detecta dobles free.
+    struct Slab {
+        Slab* sig;                 // Lista de slabs de su clase con objetos libres
+        Slab* ant;
+        void* libres;              // Objetos devueltos
+        uint32_t clase;
+        uint32_t tamObjeto;
+        uint32_t capacidad;        // Objetos que caben delante de la cabecera
+        uint32_t usados;
+        uint32_t virgenes;         // Los objetos desde aquí no se han entregado nunca
+        uint64_t ocupados[TAM_SLAB / MIN_OBJETO_SLAB / 64];
+
+        char* inicio() { return reinterpret_cast<char*>(this + 1) - TAM_SLAB; }
+    };
+
+    struct ClaseSlab {
+        Slab* parciales;           // Slabs con algún objeto libre
+        size_t slabs;
+        uint64_t objetos;          // Entregados ahora
+        std::mutex cerrojo;        // Sólo en modo concurrente; se toma antes que el del núcleo
+    };
+
+    // Página inicial del segmento compartido; la arena empieza en la siguiente
+    struct CabeceraCompartida {
+        uint64_t magia;
+        uint32_t version;
+        std::atomic<uint32_t> listo;       // Lo publica el proceso que lo inicializa
+        size_t tamano;                     // Árbol buddy de la arena
+        pthread_mutex_t cerrojo;           // PTHREAD_PROCESS_SHARED y robusto
+        uint64_t secuencia;                // Última publicada en el índice
+        EntradaIndice indice[MAX_ENTRADAS_INDICE];  // Protegido por el cerrojo
+    };
+    static_assert(sizeof(CabeceraCompartida) <= TAM_PAGINA, "La cabecera debe caber en una página");
+
+    // Cerrojo del núcleo: un std::mutex, o en el pool compartido el mutex del
+    // segmento. Si un proceso muere con él tomado, el siguiente lo recupera.
+    class CerrojoNucleo {
+    public:
+        void lock();
+        void unlock();
+        void compartir(pthread_mutex_t* m) { compartido = m; }
+
+    private:
+        std::mutex local;
+        pthread_mutex_t* compartido = nullptr;
+    };
+
+    // Bloques recién liberados de un nivel, propiedad de un único hilo
+    struct Cargador {
+        int cuenta;
+        void* bloques[CAPACIDAD_CARGADOR];
+    };
+
+    Arena* arenas[MAX_ARENAS];
+    std::atomic<int> numArenas;
+    std::atomic<size_t> totalSize;     // Suma de los árboles de todas las arenas
+    size_t tamArenaBase;               // Tamaño de las arenas nuevas
+    bool crecer;
+    RespaldoPool respaldo;
+    bool numaLocal;
+    PrecargaPool precarga;
+    size_t marcaDiferida;
+    bool compuestos;
+    size_t devolverDesde;
+    bool devolucionPerezosa;
+    bool concurrente;
+    bool slabs;
+    ClaseSlab clasesSlab[NUM_CLASES_SLAB];
+    Cargador* cargadores;              // MAX_HILOS x NIVELES_CACHE, mapeados aparte
+    size_t bytesCargadores;
+    mutable CerrojoNucleo cerrojo;     // Protege el núcleo en modo concurrente
+    int fdSegmento;                    // Objeto compartido, o -1
+
+    // Estadísticas (ver getStats)
+    std::atomic<uint64_t> contAllocs, contFrees, contSplits, contCoalesces, contFallos;
+    std::atomic<uint64_t> contDiferidos, contCompuestos, bytesRecortados;
+    std::atomic<uint64_t> contTrims, bytesDevueltos;
+    std::atomic<uint64_t> bytesEnUso, bytesSolicitados, picoBytesEnUso;
+    std::atomic<uint64_t> contAllocsSlab, contFreesSlab;
+    std::atomic<uint64_t> bytesEtiqueta[BuddyEstadisticas::NUM_ETIQUETAS];
+    std::atomic<uint64_t> picoEtiqueta[BuddyEstadisticas::NUM_ETIQUETAS];
+    struct HistogramasLatencia;        // Sólo se reserva con BUDDY_LATENCIAS
+    HistogramasLatencia* latencias;
+
+    // Hilo de trim periódico (ver BuddyOpciones::intervaloTrim)
+    std::thread hiloTrim;
+    std::mutex cerrojoTrim;
+    std::condition_variable avisoTrim;
+    bool pararTrim;
+
+    // Traza (ver iniciarTraza)
+    std::atomic<int> trazaFd;
+    RegistroTraza* trazaBuffer;
+    size_t trazaCuenta;
+    std::chrono::steady_clock::time_point trazaInicio;
+    std::mutex cerrojoTraza;
 
     int getLevel(size_t size) const;
     size_t getBlockSize(int level) const;
-    size_t offset(void* ptr) const;
-    void* buddyOf(void* ptr, int level) const;
-    bool split(int level); // Modificado para retornar éxito/fallo
-    void coalesce(void* ptr, int level);
+    size_t buddyOf(size_t off, int level) const;
+    void split(Arena* a, size_t off, int level);
+    void coalesce(Arena* a, size_t off, int level);
+    bool fusionarDiferidos(Arena* a);  // true si fusionó algún par
+    size_t devolverLibres(Arena* a);   // madvise de los bloques libres grandes
+    void bucleTrim(std::chrono::milliseconds intervalo);
     bool isAligned(void* ptr, size_t alignment) const;
+
+    // Contadores: con un único escritor basta load+store; en modo concurrente
+    // los caminos sin cerrojo necesitan fetch_add
+    void sumar(std::atomic<uint64_t>& c, uint64_t v);
+    // recorte: bytes del bloque potencia de 2 devueltos por una compuesta
+    void registrarAlloc(int level, size_t solicitado, size_t recorte, int etiqueta);
+    void registrarFree(int level, size_t solicitado, size_t recorte, int etiqueta);
+    void registrarCambio(const MetaBloque& antes, const MetaBloque& despues);
+    void actualizarPico(size_t enUso);
+    void sumarEtiqueta(int etiqueta, uint64_t bytes);
+    void anotarLatencia(int operacion, int level, uint64_t inicio);  // inicio: leerCiclos()
+
+    // Arenas: creación bajo demanda y búsqueda por dirección
+    Arena* crearArena(size_t tamano, int nodo);
+    Arena* arenaDe(const void* ptr) const;
+    void* mapearRegion(size_t& tamMapeo, int& respaldoObtenido, bool poblar) const;
+    bool abrirCompartido(const BuddyOpciones& opciones);
+    bool adjuntarCompartido(bool esperar = true);
+    bool inicializarCompartido();      // Arena y cabecera de un segmento vacío
+    bool abrirPersistente(const std::string& ruta);
+    bool indiceCoherente();            // Índice y bloques ocupados cuadran
+    CabeceraCompartida* cabeceraCompartida() const;
+
+    // Operaciones públicas sin traza (realloc se apoya en ellas)
+    void* allocInterno(size_t size, size_t alineacion = MIN_BLOCK_SIZE,
+                       EtiquetaMemoria etiqueta = EtiquetaMemoria::Ninguna);
+    void freeInterno(void* ptr);
+    void* reallocInterno(void* ptr, size_t newSize);
+    bool reallocEnSitio(Arena* a, char* blockPtr, size_t newSize);
+    void encoger(Arena* a, size_t off, MetaBloque* m, size_t newSize);
+    bool crecerEnSitio(Arena* a, size_t off, MetaBloque* m, size_t newSize);
+
+    size_t huellaBloque(const MetaBloque& m) const;  // Bytes que ocupa en el pool
+    MetaBloque* metaDe(Arena* a, const void* blockPtr) const;
+
+    void registrarTraza(OpTraza op, size_t size, void* id, void* idPrevio);
+    void volcarTraza();
+
+    // Núcleo buddy sin sincronización: devuelven/reciben el inicio del bloque
+    char* allocNucleo(int level);
+    char* allocEnArena(Arena* a, int level);
+    bool freeNucleo(Arena* a, char* blockPtr);
+    bool piezaValida(Arena* a, size_t off, size_t level) const;
+    void liberarPieza(Arena* a, size_t off, int level);
+
+    // Reservas compuestas: las piezas se deducen de (nivel, tamaño) con el
+    // mismo recorrido al reservar y al liberar, sin guardar nada más
+    char* allocCompuesto(int level, size_t necesario, size_t& recorte);
+    size_t recortarCola(Arena* a, size_t off, int level, size_t necesario);
+    int piezasCompuesto(size_t off, int level, size_t necesario,
+                        size_t* offs, int* niveles) const;
+    void encogerCompuesto(Arena* a, size_t off, int level, size_t necesario, size_t nuevo);
+    bool colaLibre(Arena* a, size_t off, int level, size_t necesario) const;
+    void reensamblar(Arena* a, size_t off, int level, size_t necesario);
+    static size_t necesarioDe(size_t size);  // Bytes de bloque para size
+
+    // Slabs: clase de un tamaño, slab que contiene un puntero (nullptr si
+    // no es un objeto pequeño) y reserva/liberación de objetos
+    static int claseSlab(size_t size);
+    static size_t tamClase(int clase);
+    bool sirveSlab(size_t size, size_t alineacion) const;
+    Slab* slabDe(Arena* a, const void* ptr) const;
+    void* allocSlab(size_t size);
+    bool freeSlab(Slab* s, void* ptr);
+    Slab* nuevoSlab(int clase);
+    void soltarSlab(Slab* s);      // Devuelve al núcleo un slab vacío
+    size_t liberarSlabsVacios();
+
+    // Camino concurrente con cargadores por hilo
+    char* allocConcurrente(int level);
+    bool freeConcurrente(Arena* a, char* blockPtr);
+    Cargador* cargadorDe(int hilo, int level) const;
+
+    // Listas libres doblemente enlazadas (O(1) para insertar y quitar)
+    NodoLibre* nodo(Arena* a, size_t off) const;
+    void insertarLibre(Arena* a, size_t off, int level);
+    void quitarLibre(Arena* a, size_t off, int level);
+    size_t sacarLibre(Arena* a, int level);
+
+    // Acceso a los bitmaps por (nivel, offset)
+    size_t indiceBloque(size_t off, int level) const;
+    bool leerBit(Arena* a, const uint64_t* bits, size_t off, int level) const;
+    void ponerBit(Arena* a, uint64_t* bits, size_t off, int level, bool valor);
 };
 
-#endif // BUDDY_ALLOCATOR_H
\ No newline at end of file
+#endif // BUDDY_ALLOCATOR_H
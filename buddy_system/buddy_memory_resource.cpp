@@ -0,0 +1,17 @@
+// buddy_system/buddy_memory_resource.cpp
+#include "buddy_memory_resource.h"
+
+void* BuddyMemoryResource::do_allocate(size_t bytes, size_t alignment) {
+    void* p = buddyReservarAlineado(allocator, bytes, alignment);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void BuddyMemoryResource::do_deallocate(void* p, size_t, size_t alignment) {
+    buddyLiberarAlineado(allocator, p, alignment);
+}
+
+bool BuddyMemoryResource::do_is_equal(const std::pmr::memory_resource& otro) const noexcept {
+    auto* o = dynamic_cast<const BuddyMemoryResource*>(&otro);
+    return o && &o->allocator == &allocator;
+}
@@ -0,0 +1,91 @@
+// buddy_memory_resource.h
+// Adaptadores para que los contenedores de la STL vivan en el pool buddy:
+//  - BuddyMemoryResource: std::pmr::memory_resource (std::pmr::vector, string...)
+//  - BuddyStlAllocator<T>: allocator clásico para std::vector<T, ...>, etc.
+// Ambos respetan la alineación pedida: hasta la de std::max_align_t basta
+// alloc(), hasta BuddyAllocator::ALINEACION_MAXIMA la da el propio pool
+// (allocAligned); para alineaciones mayores se
+// sobre-reserva y se guarda delante del puntero alineado la dirección original.
+#ifndef BUDDY_MEMORY_RESOURCE_H
+#define BUDDY_MEMORY_RESOURCE_H
+
+#include "buddy_allocator.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <new>
+
+// Alineación que alloc() garantiza sin trabajo extra: los objetos de slab
+// (BuddyOpciones::slabs) sólo quedan alineados a 16 bytes
+static const size_t BUDDY_ALINEACION_NATURAL = alignof(std::max_align_t);
+
+inline void* buddyReservarAlineado(BuddyAllocator& a, size_t bytes, size_t alineacion) {
+    if (alineacion <= BUDDY_ALINEACION_NATURAL) return a.alloc(bytes);
+    if (alineacion <= BuddyAllocator::ALINEACION_MAXIMA) return a.allocAligned(bytes, alineacion);
+
+    // El desplazamiento hasta la dirección alineada es >= 64 bytes, así que
+    // siempre cabe la dirección original justo antes
+    char* bruto = static_cast<char*>(a.alloc(bytes + alineacion));
+    if (!bruto) return nullptr;
+    uintptr_t alineado = (reinterpret_cast<uintptr_t>(bruto) + alineacion) & ~(alineacion - 1);
+    reinterpret_cast<void**>(alineado)[-1] = bruto;
+    return reinterpret_cast<void*>(alineado);
+}
+
+inline void buddyLiberarAlineado(BuddyAllocator& a, void* p, size_t alineacion) {
+    if (!p) return;
+    if (alineacion <= BuddyAllocator::ALINEACION_MAXIMA) a.free(p);
+    else a.free(static_cast<void**>(p)[-1]);
+}
+
+class BuddyMemoryResource : public std::pmr::memory_resource {
+public:
+    explicit BuddyMemoryResource(BuddyAllocator& allocator) : allocator(allocator) {}
+
+    BuddyAllocator& getAllocator() const { return allocator; }
+
+private:
+    BuddyAllocator& allocator;
+
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource& otro) const noexcept override;
+};
+
+template <typename T>
+class BuddyStlAllocator {
+public:
+    using value_type = T;
+
+    explicit BuddyStlAllocator(BuddyAllocator& allocator) noexcept : allocator(&allocator) {}
+
+    template <typename U>
+    BuddyStlAllocator(const BuddyStlAllocator<U>& otro) noexcept : allocator(otro.allocator) {}
+
+    T* allocate(size_t n) {
+        if (n > static_cast<size_t>(-1) / sizeof(T)) throw std::bad_array_new_length();
+        void* p = buddyReservarAlineado(*allocator, n * sizeof(T), alignof(T));
+        if (!p) throw std::bad_alloc();
+        return static_cast<T*>(p);
+    }
+
+    void deallocate(T* p, size_t) noexcept {
+        buddyLiberarAlineado(*allocator, p, alignof(T));
+    }
+
+    template <typename U>
+    bool operator==(const BuddyStlAllocator<U>& otro) const noexcept {
+        return allocator == otro.allocator;
+    }
+
+    template <typename U>
+    bool operator!=(const BuddyStlAllocator<U>& otro) const noexcept {
+        return allocator != otro.allocator;
+    }
+
+private:
+    template <typename U> friend class BuddyStlAllocator;
+    BuddyAllocator* allocator;
+};
+
+#endif // BUDDY_MEMORY_RESOURCE_H
@@ -0,0 +1,146 @@
+// buddy_system/buddy_new_global.cpp
+#include "buddy_new_global.h"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+// Pool inicial; crece con arenas nuevas como cualquier otro
+static const size_t TAM_POOL_NEW = 64 * 1024 * 1024;
+
+// El pool vive en memoria estática y nunca se destruye: los objetos estáticos
+// que se liberan después de main siguen encontrándolo
+alignas(BuddyAllocator) static unsigned char almacenPool[sizeof(BuddyAllocator)];
+static std::atomic<BuddyAllocator*> pool{nullptr};
+static std::atomic<int> estadoPool{0};  // 0: sin construir, 1: construyéndose, 2: listo
+
+static std::atomic<uint64_t> contPool{0}, contMalloc{0};
+
+// Dentro del pool (su constructor, un mensaje de error...) cualquier new va a
+// malloc: el cerrojo del núcleo no es recursivo
+static thread_local bool dentroDelPool = false;
+
+static void informarAlSalir() {
+    BuddyAllocator* p = pool.load(std::memory_order_acquire);
+    BuddyEstadisticas e = p->getStats();
+    std::fprintf(stderr, "[NEW GLOBAL] %llu reservas en el pool, %llu en malloc; pico %.2f MB, "
+                 "%llu objetos de slab vivos\n",
+                 static_cast<unsigned long long>(contPool.load()),
+                 static_cast<unsigned long long>(contMalloc.load()),
+                 e.picoBytesEnUso / (1024.0 * 1024.0),
+                 static_cast<unsigned long long>(e.objetosSlab));
+}
+
+BuddyAllocator* poolNewGlobal() {
+    return pool.load(std::memory_order_acquire);
+}
+
+// nullptr mientras otro hilo lo construye o si la llamada viene del propio pool
+static BuddyAllocator* poolDisponible() {
+    if (dentroDelPool) return nullptr;
+    BuddyAllocator* p = pool.load(std::memory_order_acquire);
+    if (p) return p;
+
+    int esperado = 0;
+    if (!estadoPool.compare_exchange_strong(esperado, 1, std::memory_order_acq_rel)) return nullptr;
+    dentroDelPool = true;
+    BuddyOpciones opciones;
+    opciones.slabs = true;          // Frente de clases de tamaño para lo pequeño
+    opciones.compuestos = true;
+    opciones.marcaDiferida = 4;
+    opciones.concurrente = true;    // new/delete llegan desde cualquier hilo
+    p = new (almacenPool) BuddyAllocator(TAM_POOL_NEW, opciones);
+    std::atexit(informarAlSalir);
+    dentroDelPool = false;
+    pool.store(p, std::memory_order_release);
+    estadoPool.store(2, std::memory_order_release);
+    return p;
+}
+
+static void* reservar(size_t size, size_t alineacion) {
+    if (size == 0) size = 1;
+    if (BuddyAllocator* p = poolDisponible()) {
+        if (alineacion <= ImageAllocator::ALINEACION_MAXIMA) {
+            dentroDelPool = true;
+            void* ptr = alineacion <= alignof(std::max_align_t) ? p->alloc(size)
+                                                                : p->allocAligned(size, alineacion);
+            dentroDelPool = false;
+            if (ptr) {
+                contPool.fetch_add(1, std::memory_order_relaxed);
+                return ptr;
+            }
+        }
+    }
+    contMalloc.fetch_add(1, std::memory_order_relaxed);
+    if (alineacion <= alignof(std::max_align_t)) return std::malloc(size);
+    void* ptr = nullptr;
+    return posix_memalign(&ptr, alineacion, size) == 0 ? ptr : nullptr;
+}
+
+static void liberar(void* ptr) {
+    if (!ptr) return;
+    BuddyAllocator* p = pool.load(std::memory_order_acquire);
+    if (p && p->contiene(ptr)) {
+        bool antes = dentroDelPool;
+        dentroDelPool = true;
+        p->free(ptr);
+        dentroDelPool = antes;
+    } else {
+        std::free(ptr);
+    }
+}
+
+// Como exige el estándar: si ni el pool ni malloc pueden, se llama al
+// new_handler instalado (que puede liberar memoria) y se reintenta; sin
+// handler, bad_alloc
+static void* reservarOLanzar(size_t size, size_t alineacion) {
+    void* ptr;
+    while (!(ptr = reservar(size, alineacion))) {
+        std::new_handler h = std::get_new_handler();
+        if (!h) throw std::bad_alloc();
+        h();
+    }
+    return ptr;
+}
+
+// Las variantes nothrow también pasan por el new_handler: nullptr sólo
+// cuando éste (o la falta de él) acaba en bad_alloc
+static void* reservarSinLanzar(size_t size, size_t alineacion) noexcept {
+    try {
+        return reservarOLanzar(size, alineacion);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void* operator new(size_t size) { return reservarOLanzar(size, 0); }
+void* operator new[](size_t size) { return reservarOLanzar(size, 0); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return reservarSinLanzar(size, 0); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return reservarSinLanzar(size, 0); }
+
+void* operator new(size_t size, std::align_val_t a) {
+    return reservarOLanzar(size, static_cast<size_t>(a));
+}
+void* operator new[](size_t size, std::align_val_t a) {
+    return reservarOLanzar(size, static_cast<size_t>(a));
+}
+void* operator new(size_t size, std::align_val_t a, const std::nothrow_t&) noexcept {
+    return reservarSinLanzar(size, static_cast<size_t>(a));
+}
+void* operator new[](size_t size, std::align_val_t a, const std::nothrow_t&) noexcept {
+    return reservarSinLanzar(size, static_cast<size_t>(a));
+}
+
+void operator delete(void* ptr) noexcept { liberar(ptr); }
+void operator delete[](void* ptr) noexcept { liberar(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { liberar(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { liberar(ptr); }
+void operator delete(void* ptr, size_t) noexcept { liberar(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { liberar(ptr); }
+
+void operator delete(void* ptr, std::align_val_t) noexcept { liberar(ptr); }
+void operator delete[](void* ptr, std::align_val_t) noexcept { liberar(ptr); }
+void operator delete(void* ptr, std::align_val_t, const std::nothrow_t&) noexcept { liberar(ptr); }
+void operator delete[](void* ptr, std::align_val_t, const std::nothrow_t&) noexcept { liberar(ptr); }
+void operator delete(void* ptr, size_t, std::align_val_t) noexcept { liberar(ptr); }
+void operator delete[](void* ptr, size_t, std::align_val_t) noexcept { liberar(ptr); }
@@ -0,0 +1,20 @@
+// buddy_new_global.h
+// Sustitución opcional de los operator new/delete globales (todas las
+// variantes: normales, de array, nothrow, alineadas y con tamaño) por un pool
+// BuddyAllocator con slabs como frente de clases de tamaño. Sólo se activa
+// enlazando buddy_new_global.o (ver el objetivo Parcial2_Danna_newbuddy en
+// src/Makefile): sirve para medir cuánto del coste del modo convencional es
+// del allocator del sistema y cuánto de su estructura de datos.
+// Si el pool no puede servir una petición (agotado, alineación mayor de 4 KB
+// o una reserva hecha desde dentro del propio pool), se usa malloc; delete
+// distingue el origen con contiene(). Si tampoco malloc puede, se llama al
+// new_handler instalado y se reintenta, también en las variantes nothrow.
+#ifndef BUDDY_NEW_GLOBAL_H
+#define BUDDY_NEW_GLOBAL_H
+
+#include "buddy_allocator.h"
+
+// El pool de new/delete, o nullptr si aún no se ha construido
+BuddyAllocator* poolNewGlobal();
+
+#endif // BUDDY_NEW_GLOBAL_H
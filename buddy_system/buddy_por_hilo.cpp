@@ -0,0 +1,269 @@
+// buddy_system/buddy_por_hilo.cpp
+#include "buddy_por_hilo.h"
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <unordered_map>
+#include <vector>
+
+const int BuddyPorHilo::MAX_HILOS;
+
+// Instancias vivas por id: un hilo que termina sólo suelta sus ranuras en las
+// que aún existen
+static std::mutex cerrojoInstancias;
+static std::unordered_map<uint64_t, BuddyPorHilo*> instancias;
+static std::atomic<uint64_t> siguienteId{1};
+
+struct BuddyPorHilo::RanurasHilo {
+    struct Entrada {
+        uint64_t instancia;
+        int ranura;
+    };
+    std::vector<Entrada> entradas;
+    uint64_t ultimaInstancia = 0;   // La última consultada, sin recorrer el vector
+    Ranura* ultimaRanura = nullptr;
+
+    ~RanurasHilo() {
+        std::lock_guard<std::mutex> guard(cerrojoInstancias);
+        for (const Entrada& e : entradas) {
+            auto it = instancias.find(e.instancia);
+            if (it != instancias.end()) it->second->soltarRanura(e.ranura);
+        }
+    }
+};
+
+BuddyPorHilo::BuddyPorHilo(size_t tamPool, const BuddyOpciones& opciones)
+    : numRanuras(0), tamPool(tamPool), opciones(opciones),
+      id(siguienteId.fetch_add(1, std::memory_order_relaxed)) {
+    // Cada pool tiene un único dueño: ni cerrojo ni segmento compartido
+    this->opciones.concurrente = false;
+    this->opciones.intervaloTrim = std::chrono::milliseconds(0);
+    this->opciones.compartido = false;
+    this->opciones.nombreCompartido.clear();
+    this->opciones.fdCompartido = -1;
+    this->opciones.archivoPersistente.clear();
+
+    for (Ranura& r : ranuras) {
+        r.remotos.store(nullptr, std::memory_order_relaxed);
+        r.ocupada.store(false, std::memory_order_relaxed);
+        r.pool.store(nullptr, std::memory_order_relaxed);
+        r.contRemotos.store(0, std::memory_order_relaxed);
+        r.contDrenados.store(0, std::memory_order_relaxed);
+    }
+    std::lock_guard<std::mutex> guard(cerrojoInstancias);
+    instancias[id] = this;
+}
+
+BuddyPorHilo::~BuddyPorHilo() {
+    {
+        std::lock_guard<std::mutex> guard(cerrojoInstancias);
+        instancias.erase(id);
+    }
+    liberarScratch();
+    // Los bloques pendientes en las pilas remotas desaparecen con su pool
+    for (Ranura& r : ranuras) delete r.pool.load(std::memory_order_acquire);
+}
+
+BuddyPorHilo::Ranura* BuddyPorHilo::ranuraActual(bool reclamar) {
+    static thread_local RanurasHilo hilo;
+    if (hilo.ultimaInstancia == id) return hilo.ultimaRanura;
+    for (const RanurasHilo::Entrada& e : hilo.entradas) {
+        if (e.instancia == id) {
+            hilo.ultimaInstancia = id;
+            hilo.ultimaRanura = &ranuras[e.ranura];
+            return hilo.ultimaRanura;
+        }
+    }
+    if (!reclamar) return nullptr;
+
+    for (int i = 0; i < MAX_HILOS; ++i) {
+        bool ocupada = false;
+        if (!ranuras[i].ocupada.compare_exchange_strong(ocupada, true, std::memory_order_acquire)) {
+            continue;
+        }
+        int n = numRanuras.load(std::memory_order_relaxed);
+        while (n < i + 1 && !numRanuras.compare_exchange_weak(n, i + 1, std::memory_order_release)) {}
+        hilo.entradas.push_back({id, i});
+        hilo.ultimaInstancia = id;
+        hilo.ultimaRanura = &ranuras[i];
+        return hilo.ultimaRanura;
+    }
+    std::cerr << "Error: más de " << MAX_HILOS << " hilos usando el mismo BuddyPorHilo\n";
+    return nullptr;
+}
+
+// El hilo que termina aún es el dueño: devuelve lo pendiente a su pool antes
+// de dejarlo para el siguiente
+void BuddyPorHilo::soltarRanura(int i) {
+    Ranura& r = ranuras[i];
+    if (r.pool.load(std::memory_order_relaxed)) drenar(r);
+    r.ocupada.store(false, std::memory_order_release);
+}
+
+BuddyAllocator* BuddyPorHilo::poolActual() {
+    Ranura* r = ranuraActual(true);
+    if (!r) return nullptr;
+    BuddyAllocator* pool = r->pool.load(std::memory_order_relaxed);
+    if (!pool) {
+        pool = new BuddyAllocator(tamPool, opciones);
+        r->pool.store(pool, std::memory_order_release);
+    }
+    drenar(*r);
+    return pool;
+}
+
+// Se lleva la pila entera de una vez (exchange), así que no hay ABA: los
+// demás hilos sólo apilan
+void BuddyPorHilo::drenar(Ranura& r) {
+    if (!r.remotos.load(std::memory_order_relaxed)) return;
+    NodoRemoto* n = r.remotos.exchange(nullptr, std::memory_order_acquire);
+    BuddyAllocator* pool = r.pool.load(std::memory_order_relaxed);
+    uint64_t cuenta = 0;
+    while (n) {
+        NodoRemoto* sig = n->sig;
+        pool->free(n);
+        n = sig;
+        ++cuenta;
+    }
+    r.contDrenados.store(r.contDrenados.load(std::memory_order_relaxed) + cuenta,
+                         std::memory_order_relaxed);
+}
+
+BuddyPorHilo::Ranura* BuddyPorHilo::duenoDe(const void* ptr) const {
+    if (!ptr) return nullptr;
+    int n = numRanuras.load(std::memory_order_acquire);
+    for (int i = 0; i < n; ++i) {
+        BuddyAllocator* pool = ranuras[i].pool.load(std::memory_order_acquire);
+        if (pool && pool->contiene(ptr)) return const_cast<Ranura*>(&ranuras[i]);
+    }
+    return nullptr;
+}
+
+void* BuddyPorHilo::alloc(size_t size) {
+    BuddyAllocator* pool = poolActual();
+    return pool ? pool->alloc(size) : nullptr;
+}
+
+void* BuddyPorHilo::allocAligned(size_t size, size_t alignment) {
+    BuddyAllocator* pool = poolActual();
+    return pool ? pool->allocAligned(size, alignment) : nullptr;
+}
+
+void BuddyPorHilo::free(void* ptr) {
+    if (!ptr) return;
+    // Lo habitual en un hilo que reserva y libera lo suyo: su propio pool
+    Ranura* propia = ranuraActual(false);
+    BuddyAllocator* pool = propia ? propia->pool.load(std::memory_order_relaxed) : nullptr;
+    if (pool && pool->contiene(ptr)) {
+        pool->free(ptr);
+        return;
+    }
+
+    Ranura* dueno = duenoDe(ptr);
+    if (!dueno) {
+        std::cerr << "Error: free de un puntero que no es de ningún pool por hilo\n";
+        return;
+    }
+    NodoRemoto* nodo = static_cast<NodoRemoto*>(ptr);
+    nodo->sig = dueno->remotos.load(std::memory_order_relaxed);
+    while (!dueno->remotos.compare_exchange_weak(nodo->sig, nodo, std::memory_order_release,
+                                                 std::memory_order_relaxed)) {}
+    dueno->contRemotos.fetch_add(1, std::memory_order_relaxed);
+}
+
+void* BuddyPorHilo::realloc(void* ptr, size_t newSize) {
+    if (!ptr) return alloc(newSize);
+    if (newSize == 0) {
+        free(ptr);
+        return nullptr;
+    }
+    BuddyAllocator* pool = poolActual();
+    if (!pool) return nullptr;
+    if (pool->contiene(ptr)) return pool->realloc(ptr, newSize);
+
+    // Bloque de otro hilo: se copia al pool propio y el original vuelve al suyo
+    size_t copiar = capacidad(ptr);
+    if (copiar == 0) {
+        std::cerr << "Error: realloc de un puntero que no es de ningún pool por hilo\n";
+        return nullptr;
+    }
+    void* nuevo = pool->alloc(newSize);
+    if (!nuevo) return nullptr;
+    std::memcpy(nuevo, ptr, std::min(copiar, newSize));
+    free(ptr);
+    return nuevo;
+}
+
+size_t BuddyPorHilo::capacidad(const void* ptr) const {
+    Ranura* dueno = duenoDe(ptr);
+    return dueno ? dueno->pool.load(std::memory_order_acquire)->capacidad(ptr) : 0;
+}
+
+size_t BuddyPorHilo::trim() {
+    Ranura* r = ranuraActual(false);
+    BuddyAllocator* pool = r ? r->pool.load(std::memory_order_relaxed) : nullptr;
+    if (!pool) return 0;
+    drenar(*r);
+    return pool->trim();
+}
+
+int BuddyPorHilo::getNumPools() const {
+    int pools = 0;
+    int n = numRanuras.load(std::memory_order_acquire);
+    for (int i = 0; i < n; ++i) {
+        if (ranuras[i].pool.load(std::memory_order_acquire)) ++pools;
+    }
+    return pools;
+}
+
+void BuddyPorHilo::printStatus() const {
+    const double MB = 1024.0 * 1024.0;
+    EstadoScratch s = estadoScratch();
+    std::cout << "=== ESTADO DE LOS POOLS POR HILO ===\n";
+    std::cout << std::fixed << std::setprecision(2);
+    int n = numRanuras.load(std::memory_order_acquire);
+    for (int i = 0; i < n; ++i) {
+        const Ranura& r = ranuras[i];
+        BuddyAllocator* pool = r.pool.load(std::memory_order_acquire);
+        if (!pool) continue;
+        BuddyEstadisticas e = pool->getStats();
+        uint64_t remotos = r.contRemotos.load(std::memory_order_relaxed);
+        uint64_t drenados = r.contDrenados.load(std::memory_order_relaxed);
+        std::cout << "Pool " << i << (r.ocupada.load(std::memory_order_relaxed) ? "" : " (sin hilo)")
+                  << ": " << e.bytesEnUso / MB << " MB en uso de " << e.bytesReservados / MB
+                  << " MB, " << e.allocs << " alloc, " << e.frees << " free, " << remotos
+                  << " frees remotos (" << remotos - drenados << " pendientes)\n";
+    }
+    if (s.buffers) {
+        std::cout << "Buffers de trabajo: " << s.buffers << " (" << s.bytes / MB << " MB), "
+                  << s.reusos << " reusos, " << s.reservas << " reservas\n";
+    }
+    std::cout << std::defaultfloat << std::setprecision(6);
+}
+
+std::string BuddyPorHilo::estadisticasJson() const {
+    EstadoScratch s = estadoScratch();
+    std::ostringstream o;
+    o << "{\"pools\":[";
+    int n = numRanuras.load(std::memory_order_acquire);
+    bool primero = true;
+    for (int i = 0; i < n; ++i) {
+        const Ranura& r = ranuras[i];
+        BuddyAllocator* pool = r.pool.load(std::memory_order_acquire);
+        if (!pool) continue;
+        o << (primero ? "" : ",") << "{\"ranura\":" << i
+          << ",\"con_hilo\":" << (r.ocupada.load(std::memory_order_relaxed) ? "true" : "false")
+          << ",\"frees_remotos\":" << r.contRemotos.load(std::memory_order_relaxed)
+          << ",\"drenados\":" << r.contDrenados.load(std::memory_order_relaxed)
+          << ",\"pool\":" << pool->estadisticasJson() << "}";
+        primero = false;
+    }
+    o << "],\"buffers_scratch\":" << s.buffers
+      << ",\"bytes_scratch\":" << s.bytes
+      << ",\"scratch_reusos\":" << s.reusos
+      << ",\"scratch_reservas\":" << s.reservas << "}";
+    return o.str();
+}
@@ -0,0 +1,81 @@
+// buddy_por_hilo.h
+// Un BuddyAllocator de un solo dueño por hilo, sin cerrojos en el camino
+// común. Cualquier hilo puede liberar un bloque: si no es el dueño de su pool,
+// el bloque se apila sin cerrojos en la pila de liberaciones remotas de ese
+// pool y el dueño la vacía en su siguiente reserva. Así, en un pipeline, el
+// hilo que decodifica un fotograma lo reserva y el que lo codifica lo libera
+// sin que un cerrojo global serialice las etapas.
+// Cada hilo ocupa una ranura mientras vive; al terminar la suelta y el pool
+// (con los bloques que aún tenga entregados) pasa al siguiente hilo nuevo.
+#ifndef BUDDY_POR_HILO_H
+#define BUDDY_POR_HILO_H
+
+#include "buddy_allocator.h"
+#include <atomic>
+#include <cstdint>
+
+class BuddyPorHilo final : public ImageAllocator {
+public:
+    static const int MAX_HILOS = 64;
+
+    // Cada pool se crea en la primera reserva de su hilo con tamPool bytes y
+    // estas opciones (sin modo concurrente ni pool compartido: tiene un dueño)
+    explicit BuddyPorHilo(size_t tamPool, const BuddyOpciones& opciones = BuddyOpciones());
+    ~BuddyPorHilo();
+
+    const char* nombre() const override { return "buddy_hilo"; }
+
+    // Siempre del pool del hilo que llama
+    void* alloc(size_t size) override;
+    void* allocAligned(size_t size, size_t alignment) override;
+    // Desde cualquier hilo; si no es el dueño, el bloque vuelve a su pool
+    // cuando el dueño reserve otra vez
+    void free(void* ptr) override;
+    // En el pool del dueño si lo llama él; si no, se mueve al del hilo que llama
+    void* realloc(void* ptr, size_t newSize) override;
+
+    bool contiene(const void* ptr) const override { return duenoDe(ptr) != nullptr; }
+    size_t capacidad(const void* ptr) const override;
+
+    // Vacía la pila remota del pool del hilo que llama y le hace trim();
+    // los pools de otros hilos sólo los toca su dueño
+    size_t trim() override;
+
+    // Las estadísticas recorren todos los pools: con el pipeline parado
+    void printStatus() const override;
+    std::string estadisticasJson() const override;
+
+    int getNumPools() const;  // Pools creados (uno por hilo que ha reservado)
+
+private:
+    // Enlace de la pila remota, escrito dentro del propio bloque liberado
+    struct NodoRemoto {
+        NodoRemoto* sig;
+    };
+
+    // En su propia línea de caché: los productores de liberaciones remotas
+    // no deben invalidar la de la ranura vecina
+    struct alignas(64) Ranura {
+        std::atomic<NodoRemoto*> remotos;      // Pila de liberaciones remotas
+        std::atomic<bool> ocupada;             // La usa un hilo vivo
+        std::atomic<BuddyAllocator*> pool;     // nullptr hasta su primera reserva
+        std::atomic<uint64_t> contRemotos;     // Bloques apilados por otros hilos
+        std::atomic<uint64_t> contDrenados;    // Bloques devueltos al vaciar la pila
+    };
+
+    struct RanurasHilo;  // Ranuras del hilo en cada instancia (thread_local)
+
+    Ranura ranuras[MAX_HILOS];
+    std::atomic<int> numRanuras; // Ranuras reclamadas alguna vez (las primeras)
+    size_t tamPool;
+    BuddyOpciones opciones;
+    uint64_t id;                 // Único en el proceso: las instancias se pueden reutilizar en memoria
+
+    Ranura* ranuraActual(bool reclamar);   // nullptr si el hilo no tiene (y no se reclama)
+    BuddyAllocator* poolActual();          // Crea el pool y vacía su pila remota
+    Ranura* duenoDe(const void* ptr) const;
+    void drenar(Ranura& r);
+    void soltarRanura(int i);
+};
+
+#endif // BUDDY_POR_HILO_H
@@ -0,0 +1,47 @@
+// buddy_traza.h
+// Formato binario de las trazas de asignación que graba BuddyAllocator
+// (ver BuddyAllocator::iniciarTraza) y que reproduce bench/replay_traza.
+// Fichero = CabeceraTraza seguida de registros de tamaño fijo.
+#ifndef BUDDY_TRAZA_H
+#define BUDDY_TRAZA_H
+
+#include <cstdint>
+
+enum OpTraza : uint8_t {
+    TRAZA_ALLOC = 1,
+    TRAZA_FREE = 2,
+    TRAZA_REALLOC = 3
+};
+
+struct CabeceraTraza {
+    char magia[4];            // "BTRZ"
+    uint32_t version;
+    uint32_t tamRegistro;     // sizeof(RegistroTraza)
+    uint32_t reservado;
+};
+
+// 32 bytes por operación. El id es la dirección entregada al usuario: un
+// free se empareja con el último alloc/realloc que devolvió ese mismo id.
+struct RegistroTraza {
+    uint64_t tiempoNs;        // Desde iniciarTraza
+    uint64_t id;              // Bloque devuelto (alloc/realloc) o liberado (free); 0 si falló
+    uint64_t idPrevio;        // realloc: bloque original
+    uint64_t tamOp;           // Tamaño solicitado en los 56 bits bajos, OpTraza en los 8 altos
+};
+
+static const char MAGIA_TRAZA[4] = {'B', 'T', 'R', 'Z'};
+static const uint32_t VERSION_TRAZA = 1;
+
+inline uint64_t empaquetarTamOp(OpTraza op, uint64_t tam) {
+    return (static_cast<uint64_t>(op) << 56) | (tam & ((1ULL << 56) - 1));
+}
+
+inline OpTraza opDe(const RegistroTraza& r) {
+    return static_cast<OpTraza>(r.tamOp >> 56);
+}
+
+inline uint64_t tamDe(const RegistroTraza& r) {
+    return r.tamOp & ((1ULL << 56) - 1);
+}
+
+#endif // BUDDY_TRAZA_H
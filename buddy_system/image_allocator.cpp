@@ -0,0 +1,108 @@
+// buddy_system/image_allocator.cpp
+#include "image_allocator.h"
+#include <cstring>
+#include <iostream>
+
+const size_t ImageAllocator::ALINEACION_MAXIMA;
+const int ImageAllocator::MAX_SCRATCH;
+
+static thread_local EtiquetaMemoria etiquetaHilo = EtiquetaMemoria::Ninguna;
+
+const char* nombreEtiqueta(EtiquetaMemoria etiqueta) {
+    switch (etiqueta) {
+    case EtiquetaMemoria::Decodificar: return "decodificar";
+    case EtiquetaMemoria::RotarSalida: return "rotar_salida";
+    case EtiquetaMemoria::EscalarSalida: return "escalar_salida";
+    case EtiquetaMemoria::Codificar: return "codificar";
+    case EtiquetaMemoria::Temporales: return "temporales";
+    case EtiquetaMemoria::Pequenos: return "pequenos";
+    default: return "sin_etiqueta";
+    }
+}
+
+EtiquetaMemoria etiquetaHiloActual() {
+    return etiquetaHilo;
+}
+
+AmbitoEtiqueta::AmbitoEtiqueta(EtiquetaMemoria etiqueta) : anterior(etiquetaHilo) {
+    etiquetaHilo = etiqueta;
+}
+
+AmbitoEtiqueta::~AmbitoEtiqueta() {
+    etiquetaHilo = anterior;
+}
+
+ImageAllocator::ImageAllocator() : scratch(), scratchReusos(0), scratchReservas(0) {}
+
+ImageAllocator::BufferScratch* ImageAllocator::buscarScratch(const char* nombre) {
+    for (BufferScratch& b : scratch) {
+        if (b.nombre[0] && std::strncmp(b.nombre, nombre, sizeof(b.nombre)) == 0) return &b;
+    }
+    return nullptr;
+}
+
+void* ImageAllocator::getScratch(const char* nombre, size_t size) {
+    std::lock_guard<std::mutex> guard(cerrojoScratch);
+    BufferScratch* b = buscarScratch(nombre);
+    if (b && size <= capacidad(b->ptr)) {
+        ++scratchReusos;
+        return b->ptr;
+    }
+
+    if (!b) {
+        for (BufferScratch& libre : scratch) {
+            if (!libre.nombre[0]) { b = &libre; break; }
+        }
+        if (!b) {
+            std::cerr << "Error: no quedan buffers de trabajo libres para '" << nombre << "'\n";
+            return nullptr;
+        }
+        std::strncpy(b->nombre, nombre, sizeof(b->nombre) - 1);
+        b->ptr = nullptr;
+    }
+
+    // No cabe: el contenido no se conserva, así que no hace falta realloc.
+    // Son buffers de imagen: se alinean a página
+    if (b->ptr) free(b->ptr);
+    ++scratchReservas;
+    b->ptr = allocAligned(size, ALINEACION_MAXIMA);
+    if (!b->ptr) b->nombre[0] = '\0';
+    return b->ptr;
+}
+
+void ImageAllocator::intercambiarScratch(const char* nombre, void* ptr) {
+    if (!ptr || !contiene(ptr)) {
+        std::cerr << "Error: el buffer de trabajo '" << nombre << "' debe pertenecer al pool\n";
+        return;
+    }
+    std::lock_guard<std::mutex> guard(cerrojoScratch);
+    BufferScratch* b = buscarScratch(nombre);
+    if (!b) {
+        std::cerr << "Error: no existe el buffer de trabajo '" << nombre << "'\n";
+        return;
+    }
+    b->ptr = ptr;
+}
+
+void ImageAllocator::liberarScratch() {
+    std::lock_guard<std::mutex> guard(cerrojoScratch);
+    for (BufferScratch& b : scratch) {
+        if (!b.nombre[0]) continue;
+        free(b.ptr);
+        b.nombre[0] = '\0';
+        b.ptr = nullptr;
+    }
+}
+
+ImageAllocator::EstadoScratch ImageAllocator::estadoScratch() const {
+    std::lock_guard<std::mutex> guard(cerrojoScratch);
+    EstadoScratch e{};
+    for (const BufferScratch& b : scratch) {
+        if (!b.nombre[0]) continue;
+        ++e.buffers;
+        e.bytes += capacidad(b.ptr);
+    }
+    e.reusos = scratchReusos;
+    e.reservas = scratchReservas;
+    return e;
+}
@@ -0,0 +1,105 @@
+// image_allocator.h
+// Interfaz común de las estrategias de memoria con las que se procesan las
+// imágenes (BuddyAllocator, TlsfAllocator, MallocAllocator), para poder
+// compararlas con los mismos kernels. Además de reservar y liberar, cada
+// estrategia sabe si un puntero es suyo y cuántos bytes útiles tiene su
+// bloque; con eso la interfaz implementa para todas los buffers de trabajo
+// con nombre (getScratch).
+#ifndef IMAGE_ALLOCATOR_H
+#define IMAGE_ALLOCATOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+// Etapa a la que se atribuye un bloque (etiqueta del sitio de reserva).
+// BuddyAllocator lleva bytes actuales y pico por etiqueta; las demás
+// estrategias la ignoran.
+enum class EtiquetaMemoria : uint8_t {
+    Ninguna,
+    Decodificar,     // stbi_load y la copia del buffer decodificado
+    RotarSalida,     // Buffer de salida de rotar
+    EscalarSalida,   // Buffer de salida de escalar
+    Codificar,       // Reservas de stbi_write_*
+    Temporales,      // Tablas de coeficientes (ScratchArena)
+    Pequenos,        // Bloques de slab: sus objetos no se atribuyen uno a uno
+    Cuenta
+};
+const char* nombreEtiqueta(EtiquetaMemoria etiqueta);
+
+// Etiqueta de las reservas del hilo que no la indican (Ninguna por defecto)
+EtiquetaMemoria etiquetaHiloActual();
+
+// Fija la etiqueta del hilo durante un ámbito y restaura la anterior al salir
+class AmbitoEtiqueta {
+public:
+    explicit AmbitoEtiqueta(EtiquetaMemoria etiqueta);
+    ~AmbitoEtiqueta();
+
+    AmbitoEtiqueta(const AmbitoEtiqueta&) = delete;
+    AmbitoEtiqueta& operator=(const AmbitoEtiqueta&) = delete;
+
+private:
+    EtiquetaMemoria anterior;
+};
+
+class ImageAllocator {
+public:
+    ImageAllocator();
+    virtual ~ImageAllocator() {}
+
+    ImageAllocator(const ImageAllocator&) = delete;
+    ImageAllocator& operator=(const ImageAllocator&) = delete;
+
+    static const size_t ALINEACION_MAXIMA = 4096;  // Máximo que acepta allocAligned
+
+    virtual const char* nombre() const = 0;
+    virtual void* alloc(size_t size) = 0;
+    virtual void* allocAligned(size_t size, size_t alignment) = 0;  // Potencia de 2
+    virtual void free(void* ptr) = 0;
+    virtual void* realloc(void* ptr, size_t newSize) = 0;
+
+    virtual bool contiene(const void* ptr) const = 0;       // El puntero es de esta estrategia
+    virtual size_t capacidad(const void* ptr) const = 0;   // Bytes útiles de su bloque
+
+    // Devuelve al sistema la memoria libre que se pueda; bytes liberados
+    virtual size_t trim() { return 0; }
+
+    virtual void printStatus() const = 0;
+    virtual std::string estadisticasJson() const = 0;
+
+    // Buffers de trabajo persistentes (alineados a página), identificados por
+    // nombre. Sobreviven entre operaciones e imágenes y sólo se vuelven a
+    // reservar si el tamaño pedido no cabe en el bloque que ya tienen.
+    void* getScratch(const char* nombre, size_t size);
+    // Ping-pong: el llamador se queda con el buffer 'nombre' y entrega a
+    // cambio ptr (un bloque de esta estrategia), que pasa a ser el nuevo buffer.
+    void intercambiarScratch(const char* nombre, void* ptr);
+    void liberarScratch();  // Devuelve todos los buffers de trabajo
+
+protected:
+    struct EstadoScratch {
+        int buffers;        // Buffers vivos
+        size_t bytes;       // Capacidad que ocupan
+        uint64_t reusos;    // getScratch servidos sin reservar
+        uint64_t reservas;  // getScratch que tuvieron que reservar
+    };
+    EstadoScratch estadoScratch() const;
+
+private:
+    static const int MAX_SCRATCH = 8;
+
+    struct BufferScratch {
+        char nombre[24];   // Vacío si la entrada está libre
+        void* ptr;
+    };
+
+    BufferScratch scratch[MAX_SCRATCH];
+    uint64_t scratchReusos, scratchReservas;
+    mutable std::mutex cerrojoScratch;
+
+    BufferScratch* buscarScratch(const char* nombre);
+};
+
+#endif // IMAGE_ALLOCATOR_H
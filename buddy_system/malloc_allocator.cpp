@@ -0,0 +1,123 @@
+// buddy_system/malloc_allocator.cpp
+#include "malloc_allocator.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <malloc.h>
+#include <sstream>
+
+MallocAllocator::MallocAllocator()
+    : contAllocs(0), contFrees(0), contFallos(0), bytesEnUso(0), picoBytesEnUso(0) {}
+
+// Los buffers de trabajo son de este heap: se devuelven antes de que
+// desaparezca el objeto que sabe liberarlos
+MallocAllocator::~MallocAllocator() {
+    liberarScratch();
+}
+
+void MallocAllocator::anotarAlloc(void* ptr) {
+    if (!ptr) {
+        contFallos.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    contAllocs.fetch_add(1, std::memory_order_relaxed);
+    size_t enUso = bytesEnUso.fetch_add(malloc_usable_size(ptr), std::memory_order_relaxed)
+                   + malloc_usable_size(ptr);
+    size_t pico = picoBytesEnUso.load(std::memory_order_relaxed);
+    while (enUso > pico && !picoBytesEnUso.compare_exchange_weak(pico, enUso, std::memory_order_relaxed)) {}
+}
+
+void* MallocAllocator::alloc(size_t size) {
+    void* ptr = std::malloc(size ? size : 1);
+    anotarAlloc(ptr);
+    return ptr;
+}
+
+void* MallocAllocator::allocAligned(size_t size, size_t alignment) {
+    if (alignment == 0 || (alignment & (alignment - 1)) || alignment > ALINEACION_MAXIMA) {
+        std::cerr << "Error: alineación no soportada: " << alignment << "\n";
+        return nullptr;
+    }
+    if (alignment < sizeof(void*)) alignment = sizeof(void*);
+    void* ptr = nullptr;
+    if (posix_memalign(&ptr, alignment, size ? size : 1) != 0) ptr = nullptr;
+    anotarAlloc(ptr);
+    return ptr;
+}
+
+void MallocAllocator::free(void* ptr) {
+    if (!ptr) return;
+    contFrees.fetch_add(1, std::memory_order_relaxed);
+    bytesEnUso.fetch_sub(malloc_usable_size(ptr), std::memory_order_relaxed);
+    std::free(ptr);
+}
+
+// realloc de glibc no conserva alineaciones mayores de 16 bytes: esos
+// bloques se mueven a mano
+void* MallocAllocator::realloc(void* ptr, size_t newSize) {
+    if (!ptr) return alloc(newSize);
+    if (newSize == 0) { free(ptr); return nullptr; }
+
+    size_t previo = malloc_usable_size(ptr);
+    uintptr_t direccion = reinterpret_cast<uintptr_t>(ptr);
+    size_t alineacion = direccion & (~direccion + 1);
+    if (alineacion > 2 * sizeof(void*) && newSize > previo) {
+        void* nuevo = allocAligned(newSize, std::min<size_t>(alineacion, ALINEACION_MAXIMA));
+        if (!nuevo) return nullptr;
+        std::memcpy(nuevo, ptr, previo);
+        free(ptr);
+        return nuevo;
+    }
+
+    void* nuevo = std::realloc(ptr, newSize);
+    if (!nuevo) {
+        contFallos.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    bytesEnUso.fetch_sub(previo, std::memory_order_relaxed);
+    contFrees.fetch_add(1, std::memory_order_relaxed);
+    anotarAlloc(nuevo);
+    return nuevo;
+}
+
+size_t MallocAllocator::capacidad(const void* ptr) const {
+    return malloc_usable_size(const_cast<void*>(ptr));
+}
+
+// malloc_trim no dice cuánto devolvió: se informa 0
+size_t MallocAllocator::trim() {
+    malloc_trim(0);
+    return 0;
+}
+
+void MallocAllocator::printStatus() const {
+    const double MB = 1024.0 * 1024.0;
+    EstadoScratch s = estadoScratch();
+    std::cout << "=== ESTADO DE MALLOC ===\n";
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "En uso: " << bytesEnUso.load() / MB << " MB (pico " << picoBytesEnUso.load() / MB << " MB)\n";
+    std::cout << "Operaciones: " << contAllocs.load() << " alloc, " << contFrees.load() << " free, "
+              << contFallos.load() << " fallos\n";
+    if (s.buffers) {
+        std::cout << "Buffers de trabajo: " << s.buffers << " (" << s.bytes / MB << " MB), "
+                  << s.reusos << " reusos, " << s.reservas << " reservas\n";
+    }
+    std::cout << std::defaultfloat << std::setprecision(6);
+}
+
+std::string MallocAllocator::estadisticasJson() const {
+    EstadoScratch s = estadoScratch();
+    std::ostringstream o;
+    o << "{\"bytes_en_uso\":" << bytesEnUso.load()
+      << ",\"pico_bytes_en_uso\":" << picoBytesEnUso.load()
+      << ",\"allocs\":" << contAllocs.load()
+      << ",\"frees\":" << contFrees.load()
+      << ",\"fallos\":" << contFallos.load()
+      << ",\"buffers_scratch\":" << s.buffers
+      << ",\"bytes_scratch\":" << s.bytes
+      << ",\"scratch_reusos\":" << s.reusos
+      << ",\"scratch_reservas\":" << s.reservas << "}";
+    return o.str();
+}
@@ -0,0 +1,39 @@
+// malloc_allocator.h
+// Estrategia de referencia: delega en el malloc del proceso (posix_memalign
+// para las alineadas), sin pool propio. Sirve de línea base al comparar el
+// buddy y el TLSF con los mismos kernels. Como el heap es de todo el proceso,
+// contiene() acepta cualquier puntero y capacidad() usa malloc_usable_size.
+#ifndef MALLOC_ALLOCATOR_H
+#define MALLOC_ALLOCATOR_H
+
+#include "image_allocator.h"
+#include <atomic>
+
+class MallocAllocator final : public ImageAllocator {
+public:
+    MallocAllocator();
+    ~MallocAllocator();
+
+    const char* nombre() const override { return "malloc"; }
+
+    void* alloc(size_t size) override;
+    void* allocAligned(size_t size, size_t alignment) override;
+    void free(void* ptr) override;
+    void* realloc(void* ptr, size_t newSize) override;
+
+    bool contiene(const void* ptr) const override { return ptr != nullptr; }
+    size_t capacidad(const void* ptr) const override;
+
+    size_t trim() override;  // malloc_trim(0)
+
+    void printStatus() const override;
+    std::string estadisticasJson() const override;
+
+private:
+    std::atomic<uint64_t> contAllocs, contFrees, contFallos;
+    std::atomic<size_t> bytesEnUso, picoBytesEnUso;  // Según malloc_usable_size
+
+    void anotarAlloc(void* ptr);
+};
+
+#endif // MALLOC_ALLOCATOR_H
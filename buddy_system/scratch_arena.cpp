@@ -0,0 +1,88 @@
+// buddy_system/scratch_arena.cpp
+#include "scratch_arena.h"
+#include <algorithm>
+
+ScratchArena::ScratchArena(ImageAllocator& allocator, size_t capacidadInicial)
+    : allocator(allocator), actual(nullptr), tope(0), maximo(0),
+      capacidadInicial(std::max(capacidadInicial, ImageAllocator::ALINEACION_MAXIMA)) {}
+
+ScratchArena::~ScratchArena() {
+    while (actual) {
+        Bloque* anterior = actual->anterior;
+        allocator.free(actual);
+        actual = anterior;
+    }
+}
+
+void* ScratchArena::reservar(size_t bytes, size_t alineacion) {
+    if (alineacion == 0 || (alineacion & (alineacion - 1)) ||
+        alineacion > ImageAllocator::ALINEACION_MAXIMA) {
+        return nullptr;
+    }
+
+    // Los bloques empiezan en página, así que basta con alinear el desplazamiento
+    size_t inicio = (tope + alineacion - 1) & ~(alineacion - 1);
+    bool vacia = actual && !actual->anterior && tope == sizeof(Bloque);
+    if (!actual || inicio + bytes > actual->tam || (vacia && maximo > actual->tam)) {
+        size_t cabecera = (sizeof(Bloque) + alineacion - 1) & ~(alineacion - 1);
+        if (nuevoBloque(cabecera + bytes)) inicio = cabecera;
+        else if (!actual || inicio + bytes > actual->tam) return nullptr;
+    }
+
+    tope = inicio + bytes;
+    maximo = std::max(maximo, actual->previos + tope);
+    return reinterpret_cast<char*>(actual) + inicio;
+}
+
+// Con la arena vacía se sustituye el único bloque por uno mayor (al menos el
+// pico visto, para no volver a encadenar); con temporales vivos se encadena
+// un bloque nuevo
+bool ScratchArena::nuevoBloque(size_t minimo) {
+    bool vacia = actual && !actual->anterior && tope == sizeof(Bloque);
+    size_t tam = std::max(capacidadInicial, actual ? 2 * actual->tam : 0);
+    if (vacia) tam = std::max(tam, maximo);
+    while (tam < minimo) tam *= 2;
+
+    Bloque* b;
+    {
+        AmbitoEtiqueta etapa(EtiquetaMemoria::Temporales);
+        b = static_cast<Bloque*>(allocator.allocAligned(tam, ImageAllocator::ALINEACION_MAXIMA));
+    }
+    if (!b) return false;
+    if (vacia) {
+        allocator.free(actual);
+        actual = nullptr;
+    }
+    b->anterior = actual;
+    b->tam = tam;
+    b->previos = actual ? actual->previos + tope : 0;
+    actual = b;
+    tope = sizeof(Bloque);
+    return true;
+}
+
+// Vuelve a la marca (bloque, tope) de un Ambito: los bloques encadenados
+// después se devuelven al pool. Una marca tomada antes del primer uso deja
+// la arena vacía pero conserva su primer bloque.
+void ScratchArena::soltarHasta(void* bloque, size_t marca) {
+    while (actual && actual != bloque && actual->anterior) {
+        Bloque* anterior = actual->anterior;
+        allocator.free(actual);
+        actual = anterior;
+    }
+    tope = actual == bloque ? marca : sizeof(Bloque);
+}
+
+void ScratchArena::reiniciar() {
+    soltarHasta(nullptr, 0);
+}
+
+size_t ScratchArena::usados() const {
+    return actual ? actual->previos + tope : 0;
+}
+
+int ScratchArena::bloques() const {
+    int n = 0;
+    for (Bloque* b = actual; b; b = b->anterior) ++n;
+    return n;
+}
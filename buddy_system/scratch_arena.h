@@ -0,0 +1,73 @@
+// scratch_arena.h
+// Arena de temporales recortada de bloques de un ImageAllocator. Reservar es
+// desplazar un puntero y no hay free individual: los temporales de una
+// operación (tablas de coeficientes por fila o columna, etc.) se sueltan
+// todos a la vez al salir de su ScratchArena::Ambito, sin splits ni
+// coalesces en el pool.
+// Si un bloque se llena se encadena otro; cuando la arena vuelve a quedar
+// vacía, el primero se cambia por uno que quepa el pico, así que en régimen
+// estacionario hay un solo bloque y soltar un ámbito es O(1).
+#ifndef SCRATCH_ARENA_H
+#define SCRATCH_ARENA_H
+
+#include "image_allocator.h"
+#include <cstddef>
+
+class ScratchArena {
+public:
+    // El primer bloque se reserva en el primer uso, con al menos capacidadInicial bytes
+    explicit ScratchArena(ImageAllocator& allocator, size_t capacidadInicial = 64 * 1024);
+    ~ScratchArena();
+
+    ScratchArena(const ScratchArena&) = delete;
+    ScratchArena& operator=(const ScratchArena&) = delete;
+
+    // nullptr si el pool no tiene hueco
+    void* reservar(size_t bytes, size_t alineacion = 64);  // Potencia de 2 <= 4 KB
+
+    template <typename T>
+    T* reservarArray(size_t n) {
+        if (n > static_cast<size_t>(-1) / sizeof(T)) return nullptr;
+        return static_cast<T*>(reservar(n * sizeof(T), alignof(T) < 64 ? 64 : alignof(T)));
+    }
+
+    void reiniciar();  // Suelta todos los temporales
+
+    size_t usados() const;     // Bytes ocupados ahora, cabeceras incluidas
+    size_t pico() const { return maximo; }
+    int bloques() const;       // Bloques del pool que ocupa la arena
+
+    // Marca RAII: al destruirse suelta lo reservado desde su creación
+    class Ambito {
+    public:
+        explicit Ambito(ScratchArena& arena) : arena(arena), bloque(arena.actual), tope(arena.tope) {}
+        ~Ambito() { arena.soltarHasta(bloque, tope); }
+
+        Ambito(const Ambito&) = delete;
+        Ambito& operator=(const Ambito&) = delete;
+
+    private:
+        ScratchArena& arena;
+        void* bloque;
+        size_t tope;
+    };
+
+private:
+    // Cabecera al inicio de cada bloque encadenado
+    struct Bloque {
+        Bloque* anterior;
+        size_t tam;
+        size_t previos;  // Bytes ocupados en los bloques anteriores
+    };
+
+    ImageAllocator& allocator;
+    Bloque* actual;    // Último bloque de la cadena (nullptr hasta el primer uso)
+    size_t tope;       // Desplazamiento libre dentro de actual
+    size_t maximo;
+    size_t capacidadInicial;
+
+    bool nuevoBloque(size_t minimo);
+    void soltarHasta(void* bloque, size_t tope);
+};
+
+#endif // SCRATCH_ARENA_H
@@ -1,4 +1,60 @@
+#include "stb_wrapper.h"
+#include <cstdlib>
+#include <cstring>
+
+#define STBI_MALLOC(sz) stbPoolMalloc(sz)
+#define STBI_REALLOC_SIZED(p, oldsz, newsz) stbPoolRealloc(p, oldsz, newsz)
+#define STBI_FREE(p) stbPoolFree(p)
+#define STBIW_MALLOC(sz) stbPoolMalloc(sz)
+#define STBIW_REALLOC_SIZED(p, oldsz, newsz) stbPoolRealloc(p, oldsz, newsz)
+#define STBIW_FREE(p) stbPoolFree(p)
+
 #define STB_IMAGE_IMPLEMENTATION
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #include "stb_image.h"
 #include "stb_image_write.h"
+
+static thread_local ImageAllocator* poolActual = nullptr;
+
+void stbUsarPool(ImageAllocator* allocator) {
+    poolActual = allocator;
+}
+
+ImageAllocator* stbPoolActual() {
+    return poolActual;
+}
+
+// Los decodificadores guardan además temporales por componente (JPEG) o el
+// flujo descomprimido (PNG) del orden de la imagen: se cuenta una copia más
+size_t stbHuellaPrevista(const char* ruta, int copias) {
+    int ancho, alto, canales;
+    if (!stbi_info(ruta, &ancho, &alto, &canales)) return 0;
+    return static_cast<size_t>(ancho) * alto * canales * (copias + 1);
+}
+
+void* stbPoolMalloc(size_t size) {
+    if (poolActual) {
+        if (void* p = poolActual->alloc(size)) return p;
+    }
+    return std::malloc(size);  // Sin pool activo o pool agotado
+}
+
+void* stbPoolRealloc(void* ptr, size_t oldSize, size_t newSize) {
+    if (!ptr) return stbPoolMalloc(newSize);
+    if (!poolActual || !poolActual->contiene(ptr)) return std::realloc(ptr, newSize);
+
+    if (void* p = poolActual->realloc(ptr, newSize)) return p;
+
+    // El pool no tiene hueco: se mueve el bloque al heap
+    void* p = std::malloc(newSize);
+    if (!p) return nullptr;
+    std::memcpy(p, ptr, oldSize < newSize ? oldSize : newSize);
+    poolActual->free(ptr);
+    return p;
+}
+
+void stbPoolFree(void* ptr) {
+    if (!ptr) return;
+    if (poolActual && poolActual->contiene(ptr)) poolActual->free(ptr);
+    else std::free(ptr);
+}
@@ -0,0 +1,45 @@
+// stb_wrapper.h
+// Enlaza las reservas internas de stb_image y stb_image_write (STBI_MALLOC,
+// STBI_REALLOC_SIZED, STBI_FREE y sus STBIW_*) con un ImageAllocator por hilo (el pool buddy, TLSF...). Mientras
+// haya un pool activo en el hilo, el buffer que devuelve stbi_load ya vive en
+// el pool y se puede adoptar sin copiarlo; si no lo hay, stb usa malloc como
+// siempre.
+#ifndef STB_WRAPPER_H
+#define STB_WRAPPER_H
+
+#include "image_allocator.h"
+#include <cstddef>
+
+// Pool al que van las reservas de stb_image en el hilo llamador (nullptr = malloc)
+void stbUsarPool(ImageAllocator* allocator);
+ImageAllocator* stbPoolActual();
+
+// Activa un pool para stb_image durante un ámbito y restaura el anterior al salir.
+// Los bloques reservados dentro del ámbito deben liberarse dentro de él o
+// directamente con el pool (stbi_image_free fuera del ámbito no sabe a qué
+// pool pertenecen).
+class StbAmbitoPool {
+public:
+    explicit StbAmbitoPool(ImageAllocator* allocator) : anterior(stbPoolActual()) {
+        stbUsarPool(allocator);
+    }
+    ~StbAmbitoPool() { stbUsarPool(anterior); }
+
+    StbAmbitoPool(const StbAmbitoPool&) = delete;
+    StbAmbitoPool& operator=(const StbAmbitoPool&) = delete;
+
+private:
+    ImageAllocator* anterior;
+};
+
+// Bytes de pool que harán falta para decodificar la imagen de `ruta` y
+// trabajar con `copias` buffers de su tamaño (contando el decodificado). Sólo
+// lee la cabecera (stbi_info); 0 si stb no reconoce el fichero.
+size_t stbHuellaPrevista(const char* ruta, int copias);
+
+// Destino de las macros STBI_* y STBIW_* (definidas en stb_wrapper.cpp)
+void* stbPoolMalloc(size_t size);
+void* stbPoolRealloc(void* ptr, size_t oldSize, size_t newSize);
+void stbPoolFree(void* ptr);
+
+#endif // STB_WRAPPER_H
@@ -0,0 +1,344 @@
+// buddy_system/tlsf_allocator.cpp
+#include "tlsf_allocator.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <sys/mman.h>
+
+const size_t TlsfAllocator::ALINEACION;
+const size_t TlsfAllocator::TAM_PEQUENO;
+const size_t TlsfAllocator::MIN_DEVOLVER;
+const size_t TlsfAllocator::CABECERA;
+const size_t TlsfAllocator::MIN_BLOQUE;
+const size_t TlsfAllocator::LIBRE;
+const size_t TlsfAllocator::DEVUELTO;
+
+static const size_t TAM_PAGINA = 4096;
+
+static size_t alinearA(size_t v, size_t a) {
+    return (v + a - 1) & ~(a - 1);
+}
+
+TlsfAllocator::TlsfAllocator(size_t tamRegion, bool crecer)
+    : numRegiones(0), tamRegion(alinearA(std::max(tamRegion, TAM_PAGINA), TAM_PAGINA)),
+      crecer(crecer), mapaFL(0), mapaSL(), listas(),
+      contAllocs(0), contFrees(0), contFallos(0), contEnSitio(0),
+      bytesReservados(0), bytesLibres(0), bytesEnUso(0), picoBytesEnUso(0), bytesDevueltos(0) {
+    if (!nuevaRegion(0)) {
+        std::cerr << "Error: no se pudo reservar la región inicial del pool TLSF\n";
+        std::exit(1);
+    }
+}
+
+TlsfAllocator::~TlsfAllocator() {
+    for (int i = 0; i < numRegiones; ++i) munmap(regiones[i].base, regiones[i].tam);
+}
+
+// Cada región es [bloque libre][centinela]: el centinela es una cabecera
+// ocupada de tamaño 0 que impide fusionar más allá del final
+bool TlsfAllocator::nuevaRegion(size_t minimo) {
+    if (numRegiones == MAX_REGIONES) return false;
+    size_t tam = std::max(tamRegion, alinearA(redondearBusqueda(minimo) + CABECERA, TAM_PAGINA));
+    void* m = mmap(nullptr, tam, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (m == MAP_FAILED) return false;
+
+    Bloque* b = static_cast<Bloque*>(m);
+    b->anteriorFisico = nullptr;
+    b->tam = tam - CABECERA;
+    Bloque* centinela = siguiente(b);
+    centinela->anteriorFisico = b;
+    centinela->tam = 0;
+
+    regiones[numRegiones++] = {static_cast<char*>(m), tam};
+    bytesReservados += tam;
+    b->tam |= LIBRE;
+    insertar(b);
+    return true;
+}
+
+void TlsfAllocator::indices(size_t tam, int& fl, int& sl) {
+    if (tam < TAM_PEQUENO) {
+        fl = 0;
+        sl = static_cast<int>(tam >> ALINEACION_LOG2);
+        return;
+    }
+    int f = 63 - __builtin_clzll(tam);
+    sl = static_cast<int>((tam >> (f - SL_LOG2)) ^ SL_CUENTA);
+    fl = f - FL_DESPLAZAMIENTO + 1;
+}
+
+// Se busca desde el tramo siguiente al de tam: cualquier bloque de ese tramo
+// o de uno mayor sirve sin recorrer la lista
+size_t TlsfAllocator::redondearBusqueda(size_t tam) {
+    if (tam >= TAM_PEQUENO) tam += (size_t(1) << (63 - __builtin_clzll(tam) - SL_LOG2)) - 1;
+    return tam;
+}
+
+size_t TlsfAllocator::necesarioPara(size_t size) {
+    return std::max(alinearA(std::max<size_t>(size, 1), ALINEACION) + CABECERA, MIN_BLOQUE);
+}
+
+void TlsfAllocator::insertar(Bloque* b) {
+    int fl, sl;
+    indices(tamDe(b), fl, sl);
+    // Un bloque que entra en la lista es nuevo o fusionado: parte de sus
+    // páginas pueden estar en uso otra vez
+    b->tam &= ~DEVUELTO;
+    b->antLibre = nullptr;
+    b->sigLibre = listas[fl][sl];
+    if (b->sigLibre) b->sigLibre->antLibre = b;
+    listas[fl][sl] = b;
+    mapaFL |= 1ULL << fl;
+    mapaSL[fl] |= 1U << sl;
+    bytesLibres += tamDe(b);
+}
+
+void TlsfAllocator::quitar(Bloque* b) {
+    int fl, sl;
+    indices(tamDe(b), fl, sl);
+    if (b->antLibre) b->antLibre->sigLibre = b->sigLibre;
+    else listas[fl][sl] = b->sigLibre;
+    if (b->sigLibre) b->sigLibre->antLibre = b->antLibre;
+    if (!listas[fl][sl]) {
+        mapaSL[fl] &= ~(1U << sl);
+        if (!mapaSL[fl]) mapaFL &= ~(1ULL << fl);
+    }
+    bytesLibres -= tamDe(b);
+}
+
+TlsfAllocator::Bloque* TlsfAllocator::buscar(size_t tam) {
+    int fl, sl;
+    indices(redondearBusqueda(tam), fl, sl);
+    if (fl >= FL_CUENTA) return nullptr;
+
+    uint32_t tramos = mapaSL[fl] & (~0U << sl);
+    if (!tramos) {
+        uint64_t niveles = fl + 1 < 64 ? mapaFL & (~0ULL << (fl + 1)) : 0;
+        if (!niveles) return nullptr;
+        fl = __builtin_ctzll(niveles);
+        tramos = mapaSL[fl];
+    }
+    sl = __builtin_ctz(tramos);
+    Bloque* b = listas[fl][sl];
+    quitar(b);
+    return b;
+}
+
+TlsfAllocator::Bloque* TlsfAllocator::buscarOCrecer(size_t tam) {
+    Bloque* b = buscar(tam);
+    if (!b && crecer && nuevaRegion(tam)) b = buscar(tam);
+    return b;
+}
+
+// El bloque b (ya fuera de las listas) queda ocupado con tam bytes
+void* TlsfAllocator::entregar(Bloque* b, size_t tam) {
+    b->tam &= ~(LIBRE | DEVUELTO);
+    recortar(b, tam);
+    ++contAllocs;
+    bytesEnUso += tamDe(b);
+    picoBytesEnUso = std::max(picoBytesEnUso, bytesEnUso);
+    return reinterpret_cast<char*>(b) + CABECERA;
+}
+
+void TlsfAllocator::recortar(Bloque* b, size_t tam) {
+    size_t resto = tamDe(b) - tam;
+    if (resto < MIN_BLOQUE) return;
+    Bloque* r = reinterpret_cast<Bloque*>(reinterpret_cast<char*>(b) + tam);
+    r->anteriorFisico = b;
+    r->tam = resto;
+    siguiente(r)->anteriorFisico = r;
+    b->tam = tam | (b->tam & LIBRE);
+    fusionarEInsertar(r);
+}
+
+void TlsfAllocator::fusionarEInsertar(Bloque* b) {
+    b->tam |= LIBRE;
+    Bloque* anterior = b->anteriorFisico;
+    if (anterior && esLibre(anterior)) {
+        quitar(anterior);
+        anterior->tam = (tamDe(anterior) + tamDe(b)) | LIBRE;
+        b = anterior;
+        siguiente(b)->anteriorFisico = b;
+    }
+    Bloque* sig = siguiente(b);
+    if (esLibre(sig)) {
+        quitar(sig);
+        b->tam = (tamDe(b) + tamDe(sig)) | LIBRE;
+        siguiente(b)->anteriorFisico = b;
+    }
+    insertar(b);
+}
+
+void* TlsfAllocator::alloc(size_t size) {
+    size_t tam = necesarioPara(size);
+    Bloque* b = buscarOCrecer(tam);
+    if (!b) {
+        ++contFallos;
+        std::cerr << "Error: no hay bloques suficientes para " << size << " bytes\n";
+        return nullptr;
+    }
+    return entregar(b, tam);
+}
+
+// Se pide un bloque con margen para desplazar el inicio hasta la alineación;
+// el hueco delantero vuelve a las listas como bloque libre
+void* TlsfAllocator::allocAligned(size_t size, size_t alignment) {
+    if (alignment == 0 || (alignment & (alignment - 1)) || alignment > ALINEACION_MAXIMA) {
+        std::cerr << "Error: alineación no soportada: " << alignment << "\n";
+        return nullptr;
+    }
+    if (alignment <= ALINEACION) return alloc(size);
+
+    size_t tam = necesarioPara(size);
+    Bloque* b = buscarOCrecer(tam + alignment + MIN_BLOQUE);
+    if (!b) {
+        ++contFallos;
+        std::cerr << "Error: no hay bloques suficientes para " << size << " bytes\n";
+        return nullptr;
+    }
+
+    uintptr_t usuario = reinterpret_cast<uintptr_t>(b) + CABECERA;
+    size_t hueco = alinearA(usuario, alignment) - usuario;
+    if (hueco && hueco < MIN_BLOQUE) hueco += alignment;
+    if (hueco) {
+        Bloque* n = reinterpret_cast<Bloque*>(reinterpret_cast<char*>(b) + hueco);
+        n->anteriorFisico = b;
+        n->tam = tamDe(b) - hueco;
+        siguiente(n)->anteriorFisico = n;
+        // El anterior de b no está libre (b lo estaba), así que no se fusiona
+        b->tam = hueco | LIBRE;
+        insertar(b);
+        b = n;
+    }
+    return entregar(b, tam);
+}
+
+bool TlsfAllocator::valido(const void* ptr) const {
+    if (!contiene(ptr) || reinterpret_cast<uintptr_t>(ptr) % ALINEACION != 0) return false;
+    Bloque* b = bloqueDe(ptr);
+    return !esLibre(b) && tamDe(b) >= MIN_BLOQUE && siguiente(b)->anteriorFisico == b;
+}
+
+void TlsfAllocator::free(void* ptr) {
+    if (!ptr) return;
+    if (!valido(ptr)) {
+        std::cerr << "Error: intento de liberar un puntero no asignado\n";
+        return;
+    }
+    Bloque* b = bloqueDe(ptr);
+    ++contFrees;
+    bytesEnUso -= tamDe(b);
+    fusionarEInsertar(b);
+}
+
+void* TlsfAllocator::realloc(void* ptr, size_t newSize) {
+    if (!ptr) return alloc(newSize);
+    if (newSize == 0) { free(ptr); return nullptr; }
+    if (!valido(ptr)) {
+        std::cerr << "Error: intento de redimensionar un puntero no asignado\n";
+        return nullptr;
+    }
+
+    Bloque* b = bloqueDe(ptr);
+    size_t tam = necesarioPara(newSize);
+    size_t previo = tamDe(b);
+    Bloque* sig = siguiente(b);
+    if (tam > previo && esLibre(sig) && previo + tamDe(sig) >= tam) {
+        quitar(sig);
+        b->tam = previo + tamDe(sig);
+        siguiente(b)->anteriorFisico = b;
+    }
+    if (tam <= tamDe(b)) {
+        recortar(b, tam);
+        ++contEnSitio;
+        bytesEnUso = bytesEnUso - previo + tamDe(b);
+        picoBytesEnUso = std::max(picoBytesEnUso, bytesEnUso);
+        return ptr;
+    }
+
+    // Moverlo: se respeta la alineación que tenía el puntero
+    uintptr_t direccion = reinterpret_cast<uintptr_t>(ptr);
+    size_t alineacion = std::min<size_t>(direccion & (~direccion + 1), ALINEACION_MAXIMA);
+    void* nuevo = allocAligned(newSize, alineacion);
+    if (!nuevo) return nullptr;
+    std::memcpy(nuevo, ptr, previo - CABECERA);
+    free(ptr);
+    return nuevo;
+}
+
+bool TlsfAllocator::contiene(const void* ptr) const {
+    const char* p = static_cast<const char*>(ptr);
+    for (int i = 0; i < numRegiones; ++i) {
+        if (p >= regiones[i].base && p < regiones[i].base + regiones[i].tam) return true;
+    }
+    return false;
+}
+
+size_t TlsfAllocator::capacidad(const void* ptr) const {
+    return tamDe(bloqueDe(ptr)) - CABECERA;
+}
+
+// Se conservan la cabecera y los enlaces de cada bloque (su primera página).
+// Un bloque ya devuelto se salta: ni otro madvise ni contar sus páginas dos veces
+size_t TlsfAllocator::trim() {
+    int flMin, slMin;
+    indices(MIN_DEVOLVER, flMin, slMin);
+    size_t devuelto = 0;
+    for (int fl = flMin; fl < FL_CUENTA; ++fl) {
+        for (int sl = fl == flMin ? slMin : 0; sl < SL_CUENTA; ++sl) {
+            for (Bloque* b = listas[fl][sl]; b; b = b->sigLibre) {
+                if (b->tam & DEVUELTO) continue;
+                uintptr_t ini = alinearA(reinterpret_cast<uintptr_t>(b) + MIN_BLOQUE, TAM_PAGINA);
+                uintptr_t fin = (reinterpret_cast<uintptr_t>(b) + tamDe(b)) & ~(TAM_PAGINA - 1);
+                if (ini >= fin) continue;
+                if (madvise(reinterpret_cast<void*>(ini), fin - ini, MADV_DONTNEED) == 0) {
+                    b->tam |= DEVUELTO;
+                    devuelto += fin - ini;
+                }
+            }
+        }
+    }
+    bytesDevueltos += devuelto;
+    return devuelto;
+}
+
+void TlsfAllocator::printStatus() const {
+    const double MB = 1024.0 * 1024.0;
+    EstadoScratch s = estadoScratch();
+    std::cout << "=== ESTADO DEL POOL TLSF ===\n";
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "Regiones: " << numRegiones << " (" << bytesReservados / MB << " MB reservados)\n";
+    std::cout << "En uso: " << bytesEnUso / MB << " MB (pico " << picoBytesEnUso / MB
+              << " MB), libres: " << bytesLibres / MB << " MB\n";
+    std::cout << "Operaciones: " << contAllocs << " alloc, " << contFrees << " free, "
+              << contEnSitio << " realloc en sitio, " << contFallos << " fallos\n";
+    if (bytesDevueltos) std::cout << "Devueltos por trim: " << bytesDevueltos / MB << " MB\n";
+    if (s.buffers) {
+        std::cout << "Buffers de trabajo: " << s.buffers << " (" << s.bytes / MB << " MB), "
+                  << s.reusos << " reusos, " << s.reservas << " reservas\n";
+    }
+    std::cout << std::defaultfloat << std::setprecision(6);
+}
+
+std::string TlsfAllocator::estadisticasJson() const {
+    EstadoScratch s = estadoScratch();
+    std::ostringstream o;
+    o << "{\"regiones\":" << numRegiones
+      << ",\"bytes_reservados\":" << bytesReservados
+      << ",\"bytes_libres\":" << bytesLibres
+      << ",\"bytes_en_uso\":" << bytesEnUso
+      << ",\"pico_bytes_en_uso\":" << picoBytesEnUso
+      << ",\"allocs\":" << contAllocs
+      << ",\"frees\":" << contFrees
+      << ",\"realloc_en_sitio\":" << contEnSitio
+      << ",\"fallos\":" << contFallos
+      << ",\"bytes_devueltos\":" << bytesDevueltos
+      << ",\"buffers_scratch\":" << s.buffers
+      << ",\"bytes_scratch\":" << s.bytes
+      << ",\"scratch_reusos\":" << s.reusos
+      << ",\"scratch_reservas\":" << s.reservas << "}";
+    return o.str();
+}
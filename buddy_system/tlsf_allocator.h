@@ -0,0 +1,110 @@
+// tlsf_allocator.h
+// Two-Level Segregated Fit: segunda estrategia de pool para comparar con el
+// buddy. Las listas libres se indexan en dos niveles: el primero es log2 del
+// tamaño y el segundo divide ese rango en 32 tramos lineales. Dos bitmaps
+// localizan con ctz la primera lista no vacía que sirve, así que alloc y free
+// son O(1) y los bloques no se redondean a potencias de 2 (la fragmentación
+// interna es como mucho 1/32 más la cabecera de 16 bytes). Al liberar, un
+// bloque se fusiona con sus vecinos físicos libres. El pool crece con
+// regiones mapeadas nuevas. No es seguro para hilos (como el buddy sin
+// BuddyOpciones::concurrente).
+#ifndef TLSF_ALLOCATOR_H
+#define TLSF_ALLOCATOR_H
+
+#include "image_allocator.h"
+#include <cstddef>
+#include <cstdint>
+
+class TlsfAllocator final : public ImageAllocator {
+public:
+    explicit TlsfAllocator(size_t tamRegion, bool crecer = true);
+    ~TlsfAllocator();
+
+    const char* nombre() const override { return "tlsf"; }
+
+    void* alloc(size_t size) override;          // Alineado a 16 bytes
+    void* allocAligned(size_t size, size_t alignment) override;
+    void free(void* ptr) override;
+    // En sitio si encoge o si el vecino físico derecho está libre y basta;
+    // si hay que mover, conserva la alineación del puntero (hasta 4 KB)
+    void* realloc(void* ptr, size_t newSize) override;
+
+    bool contiene(const void* ptr) const override;
+    size_t capacidad(const void* ptr) const override;
+
+    // Devuelve al sistema (MADV_DONTNEED) las páginas interiores de los
+    // bloques libres de 1 MB o más que no se hayan devuelto ya
+    size_t trim() override;
+
+    void printStatus() const override;
+    std::string estadisticasJson() const override;
+
+private:
+    static const int SL_LOG2 = 5;                        // 32 tramos por nivel
+    static const int SL_CUENTA = 1 << SL_LOG2;
+    static const int ALINEACION_LOG2 = 4;
+    static const size_t ALINEACION = 1 << ALINEACION_LOG2;
+    static const int FL_DESPLAZAMIENTO = SL_LOG2 + ALINEACION_LOG2;
+    static const size_t TAM_PEQUENO = 1 << FL_DESPLAZAMIENTO;  // Por debajo, tramos de 16 bytes
+    static const int FL_CUENTA = 48 - FL_DESPLAZAMIENTO + 1;     // Bloques de hasta 2^48 bytes
+    static const int MAX_REGIONES = 32;
+    static const size_t MIN_DEVOLVER = 1024 * 1024;
+
+    // Cabecera de 16 bytes delante de cada bloque; los enlaces de la lista
+    // libre sólo existen (dentro de la carga útil) mientras está libre
+    struct Bloque {
+        Bloque* anteriorFisico;   // nullptr en el primero de su región
+        size_t tam;               // Bytes con cabecera, múltiplo de 16; bit 0 = libre,
+                                  // bit 1 = trim ya devolvió sus páginas
+        Bloque* sigLibre;
+        Bloque* antLibre;
+    };
+    static const size_t CABECERA = 2 * sizeof(void*);
+    static const size_t MIN_BLOQUE = sizeof(Bloque);
+    static const size_t LIBRE = 1;
+    static const size_t DEVUELTO = 2;  // Se borra al entrar en una lista o al entregarse
+
+    struct Region {
+        char* base;
+        size_t tam;
+    };
+
+    Region regiones[MAX_REGIONES];
+    int numRegiones;
+    size_t tamRegion;
+    bool crecer;
+
+    uint64_t mapaFL;                           // Bit f: hay listas no vacías en el nivel f
+    uint32_t mapaSL[FL_CUENTA];                // Bit s: listas[f][s] no está vacía
+    Bloque* listas[FL_CUENTA][SL_CUENTA];
+
+    // Estadísticas
+    uint64_t contAllocs, contFrees, contFallos, contEnSitio;
+    size_t bytesReservados, bytesLibres, bytesEnUso, picoBytesEnUso, bytesDevueltos;
+
+    static size_t tamDe(const Bloque* b) { return b->tam & ~(ALINEACION - 1); }
+    static bool esLibre(const Bloque* b) { return b->tam & LIBRE; }
+    static Bloque* siguiente(Bloque* b) {
+        return reinterpret_cast<Bloque*>(reinterpret_cast<char*>(b) + tamDe(b));
+    }
+    static Bloque* bloqueDe(const void* ptr) {
+        return reinterpret_cast<Bloque*>(const_cast<char*>(static_cast<const char*>(ptr)) - CABECERA);
+    }
+    static size_t necesarioPara(size_t size);   // Bytes de bloque para size
+
+    static void indices(size_t tam, int& fl, int& sl);
+    static size_t redondearBusqueda(size_t tam);
+
+    void insertar(Bloque* b);
+    void quitar(Bloque* b);
+    Bloque* buscar(size_t tam);                 // Saca de su lista un bloque >= tam
+    Bloque* buscarOCrecer(size_t tam);
+    bool nuevaRegion(size_t minimo);
+
+    void recortar(Bloque* b, size_t tam);       // Devuelve la cola de un bloque ocupado
+    void fusionarEInsertar(Bloque* b);
+    bool valido(const void* ptr) const;         // Puntero entregado y aún ocupado
+    void* entregar(Bloque* b, size_t tam);
+};
+
+#endif // TLSF_ALLOCATOR_H
@@ -2,46 +2,232 @@
 #include "buddy_img_processor.h"
 #include "../buddy_system/stb_image.h"
 #include "../buddy_system/stb_image_write.h"
+#include "../buddy_system/stb_wrapper.h"
+#include "../buddy_system/tlsf_allocator.h"
+#include "../buddy_system/malloc_allocator.h"
 #include <cmath>
 #include <iostream>
 #include <algorithm>
 #include <cstring>
+#include <iomanip>
+#include <memory>
+#include <cstdio>
+#include <sys/stat.h>
 
-// Crear una instancia global optimizada del allocator
-static BuddyAllocator globalAllocator(1024 * 1024 * 256); // 256MB (incrementado para soportar imágenes grandes)
+// Opciones del allocator global: las imágenes de un lote suelen tener la
+// misma resolución, así que se difiere la fusión de los bloques liberados;
+// los buffers de imagen (casi nunca potencia de 2) se sirven como compuestos
+// y los objetos pequeños (estructuras de stb, descriptores) desde slabs
+static BuddyOpciones opcionesGlobales(PrecargaPool precarga) {
+    BuddyOpciones opciones;
+    opciones.marcaDiferida = 4;
+    opciones.compuestos = true;
+    opciones.slabs = true;
+    opciones.precarga = precarga;
+    return opciones;
+}
+
+// Tamaño inicial del pool si no se puede prever desde la imagen, y mínimo
+// cuando sí: por debajo, el coste de crear la arena no cambia
+static const size_t TAM_POOL_DEFECTO = 256 * 1024 * 1024;
+static const size_t TAM_POOL_MINIMO = 4 * 1024 * 1024;
+
+// Buffers de imagen que conviven en el pool: el de la imagen y el de trabajo
+static const int COPIAS_IMAGEN = 2;
+
+static ImageAllocator* crearPool(size_t tamInicial, EstrategiaPool estrategia, PrecargaPool precarga) {
+    switch (estrategia) {
+    case EstrategiaPool::Tlsf:
+        return new TlsfAllocator(tamInicial);
+    case EstrategiaPool::Malloc:
+        return new MallocAllocator();
+    case EstrategiaPool::Buddy:
+    default:
+        return new BuddyAllocator(tamInicial, opcionesGlobales(precarga));
+    }
+}
+
+// Tamaño inicial para el pool que va a procesar la imagen de `ruta`
+static size_t tamPoolPara(const std::string& ruta) {
+    size_t huella = stbHuellaPrevista(ruta.c_str(), COPIAS_IMAGEN);
+    return huella ? std::max(huella, TAM_POOL_MINIMO) : TAM_POOL_DEFECTO;
+}
+
+// Pool global, construido en el primer uso (nunca en modo convencional) con
+// la estrategia y la precarga que indique ese primer uso, dimensionado para
+// su imagen (rutaImagen; vacía = tamaño por defecto). Después se ignoran los
+// argumentos: la cabecera de la imagen sólo se lee mientras el pool no
+// existe. Si luego se queda corto, crece con arenas o regiones nuevas.
+static ImageAllocator& poolGlobal(const std::string& rutaImagen = std::string(),
+                                  EstrategiaPool estrategia = EstrategiaPool::Buddy,
+                                  PrecargaPool precarga = PrecargaPool::Ninguna) {
+    static std::unique_ptr<ImageAllocator> pool(crearPool(
+        rutaImagen.empty() ? TAM_POOL_DEFECTO : tamPoolPara(rutaImagen), estrategia, precarga));
+    return *pool;
+}
+
+// Etiqueta de los mensajes de las funciones wrapper
+static const char* etiquetaPool() {
+    const std::string nombre = poolGlobal().nombre();
+    if (nombre == "buddy") return "Buddy Optimizado";
+    return nombre == "tlsf" ? "TLSF" : "malloc";
+}
+
+// Buffer de trabajo compartido por rotar y escalar: el resultado se escribe
+// en él y se intercambia con el buffer de la imagen (ping-pong), de modo que
+// entre operaciones e imágenes no se vuelve a reservar ni a tocar memoria nueva
+static const char* const SCRATCH_IMAGEN = "imagen";
 
-ImagenOptimizada::ImagenOptimizada(const std::string& ruta, BuddyAllocator* allocator)
-    : allocator(allocator ? allocator : &globalAllocator) {
+// Los buffers de píxeles empiezan en página (y por tanto en línea de caché):
+// ninguna fila de un kernel SIMD arranca a mitad de línea por culpa del pool
+static const size_t ALINEACION_PIXELES = ImageAllocator::ALINEACION_MAXIMA;
+
+// Caché persistente (ver abrir_cache_buddy_opt); nullptr si no se pidió
+static std::unique_ptr<BuddyAllocator> cacheImagenes;
+static const size_t TAM_CACHE = 256 * 1024 * 1024;  // El fichero es disperso
+
+// Clave de una imagen en la caché: hash de la ruta, tamaño y fecha de
+// modificación, para que una imagen reescrita no se sirva con los píxeles
+// antiguos. Vacía si no se puede leer el fichero.
+static std::string claveCache(const std::string& ruta) {
+    struct stat st;
+    if (stat(ruta.c_str(), &st) != 0) return std::string();
+    uint64_t hash = 14695981039346656037ULL;  // FNV-1a
+    for (unsigned char c : ruta) {
+        hash = (hash ^ c) * 1099511628211ULL;
+    }
+    char clave[BuddyAllocator::MAX_CLAVE_INDICE];
+    std::snprintf(clave, sizeof(clave), "%016llx-%lld-%lld.%09ld",
+                  static_cast<unsigned long long>(hash), static_cast<long long>(st.st_size),
+                  static_cast<long long>(st.st_mtim.tv_sec), st.st_mtim.tv_nsec);
+    return clave;
+}
+
+// Saca de la caché la imagen publicada hace más tiempo; false si está vacía
+static bool expulsarMasAntigua(BuddyAllocator& cache) {
+    BuddyAllocator::EntradaIndice entradas[BuddyAllocator::MAX_ENTRADAS_INDICE];
+    int n = cache.leerIndice(entradas, BuddyAllocator::MAX_ENTRADAS_INDICE);
+    if (n == 0) return false;
+    const BuddyAllocator::EntradaIndice* vieja = std::min_element(
+        entradas, entradas + n,
+        [](const BuddyAllocator::EntradaIndice& a, const BuddyAllocator::EntradaIndice& b) {
+            return a.secuencia < b.secuencia;
+        });
+    // Si otro proceso la retiró antes, también queda sitio
+    if (void* bloque = cache.retirarDelIndice(vieja->clave)) cache.free(bloque);
+    return true;
+}
+
+ImagenOptimizada::ImagenOptimizada(const std::string& ruta, ImageAllocator* allocator,
+                                   BuddyAllocator* cache)
+    : buffer(nullptr), allocator(allocator ? allocator : &poolGlobal(ruta)),
+      temporales(*this->allocator) {
+    std::string clave = cache ? claveCache(ruta) : std::string();
+    bool desdeCache = !clave.empty() && leerDeCache(*cache, clave);
+    if (!desdeCache) decodificar(ruta);
+
+    // Mostrar información de la imagen cargada
+    std::cout << "Imagen cargada" << (desdeCache ? " desde la caché" : "") << ": "
+              << ancho << "x" << alto << " con " << canales << " canales.\n";
     
-    // Cargar imagen directamente a un buffer lineal
-    buffer = stbi_load(ruta.c_str(), &ancho, &alto, &canales, 0);
+    // Calcular tamaño del buffer
+    size_t tamBuffer = ancho * alto * canales;
+    std::cout << "Tamaño del buffer: " << tamBuffer << " bytes\n";
+
+    if (!desdeCache && !clave.empty()) guardarEnCache(*cache, clave);
+}
+
+void ImagenOptimizada::decodificar(const std::string& ruta) {
+    AmbitoEtiqueta etapa(EtiquetaMemoria::Decodificar);
+    // Decodificar directamente en el pool: stb_image reserva sus buffers
+    // (incluido el de píxeles) en el allocator activo del hilo
+    {
+        StbAmbitoPool ambito(this->allocator);
+        buffer = stbi_load(ruta.c_str(), &ancho, &alto, &canales, 0);
+    }
     if (!buffer) {
         std::cerr << "Error: No se pudo cargar la imagen '" << ruta << "'.\n";
         exit(1);
     }
     
-    // Mostrar información de la imagen cargada
-    std::cout << "Imagen cargada: " << ancho << "x" << alto << " con " << canales << " canales.\n";
-    
-    // Calcular tamaño del buffer
     size_t tamBuffer = ancho * alto * canales;
-    std::cout << "Tamaño del buffer: " << tamBuffer << " bytes\n";
     
-    // Copiar el buffer a memoria administrada por el buddy allocator
-    unsigned char* buddyBuffer = static_cast<unsigned char*>(this->allocator->alloc(tamBuffer));
+    // Se adopta el buffer decodificado: los bloques de 4 KB o más ya empiezan
+    // en página. Sólo se copia si stb cayó a malloc (pool agotado) o si la
+    // imagen es tan pequeña que su bloque no llega a página
+    bool enPool = this->allocator->contiene(buffer);
+    if (enPool && reinterpret_cast<uintptr_t>(buffer) % ALINEACION_PIXELES == 0) {
+        return;
+    }
+
+    unsigned char* buddyBuffer = static_cast<unsigned char*>(
+        this->allocator->allocAligned(tamBuffer, ALINEACION_PIXELES));
     if (!buddyBuffer) {
         std::cerr << "Error: No se pudo asignar memoria para el buffer de imagen.\n";
-        stbi_image_free(buffer);
         exit(1);
     }
     
     std::memcpy(buddyBuffer, buffer, tamBuffer);
     
-    // Liberar el buffer original y usar el buffer del buddy
-    stbi_image_free(buffer);
+    // Liberar el buffer original y usar el del pool. Fuera del ámbito de stb,
+    // stbi_image_free sólo sabe liberar con malloc: si el bloque es del pool,
+    // se devuelve directamente a él
+    if (enPool) this->allocator->free(buffer);
+    else stbi_image_free(buffer);
     buffer = buddyBuffer;
 }
 
+// La imagen de la caché se copia al pool de trabajo: rotar y escalar
+// sustituyen el buffer, y la entrada debe seguir intacta para la próxima vez
+bool ImagenOptimizada::leerDeCache(BuddyAllocator& cache, const std::string& clave) {
+    BuddyAllocator::EntradaIndice entrada, despues;
+    const unsigned char* guardada =
+        static_cast<const unsigned char*>(cache.buscarEnIndice(clave.c_str(), &entrada));
+    if (!guardada) return false;
+
+    ancho = static_cast<int>(entrada.datos[0]);
+    alto = static_cast<int>(entrada.datos[1]);
+    canales = static_cast<int>(entrada.datos[2]);
+    size_t tamBuffer = static_cast<size_t>(ancho) * alto * canales;
+    if (tamBuffer == 0 || tamBuffer > cache.capacidad(guardada)) return false;
+
+    {
+        AmbitoEtiqueta etapa(EtiquetaMemoria::Decodificar);
+        buffer = static_cast<unsigned char*>(allocator->allocAligned(tamBuffer, ALINEACION_PIXELES));
+    }
+    if (!buffer) {
+        std::cerr << "Error: No se pudo asignar memoria para el buffer de imagen.\n";
+        exit(1);
+    }
+    std::memcpy(buffer, guardada, tamBuffer);
+
+    // Otro proceso pudo expulsarla mientras se copiaba: la copia sólo vale si
+    // la entrada sigue siendo la misma publicación
+    if (cache.buscarEnIndice(clave.c_str(), &despues) != guardada ||
+        despues.secuencia != entrada.secuencia) {
+        allocator->free(buffer);
+        buffer = nullptr;
+        return false;
+    }
+    return true;
+}
+
+// Publica una copia de la imagen recién decodificada, expulsando las más
+// antiguas si no cabe en el pool o el índice está lleno
+void ImagenOptimizada::guardarEnCache(BuddyAllocator& cache, const std::string& clave) const {
+    size_t tamBuffer = static_cast<size_t>(ancho) * alto * canales;
+    const uint32_t datos[4] = {static_cast<uint32_t>(ancho), static_cast<uint32_t>(alto),
+                               static_cast<uint32_t>(canales), 0};
+    do {
+        if (void* copia = cache.alloc(tamBuffer)) {
+            std::memcpy(copia, buffer, tamBuffer);
+            if (cache.publicarEnIndice(clave.c_str(), copia, datos)) return;
+            cache.free(copia);
+            if (cache.buscarEnIndice(clave.c_str())) return;  // Otro proceso se adelantó
+        }
+    } while (expulsarMasAntigua(cache));
+}
+
 ImagenOptimizada::~ImagenOptimizada() {
     if (buffer && allocator) {
         allocator->free(buffer);
@@ -54,6 +240,10 @@ void ImagenOptimizada::guardarImagen(const std::string& ruta) const {
         return;
     }
     
+    // El codificador JPEG no reserva memoria, pero los demás formatos de
+    // stb_image_write sí: van al pool con su etiqueta
+    StbAmbitoPool ambito(allocator);
+    AmbitoEtiqueta etapa(EtiquetaMemoria::Codificar);
     if (!stbi_write_jpg(ruta.c_str(), ancho, alto, canales, buffer, 95)) {
         std::cerr << "Error: No se pudo guardar la imagen en '" << ruta << "'.\n";
         exit(1);
@@ -97,6 +287,41 @@ unsigned char ImagenOptimizada::interpolacion_bilineal(float x, float y, int c)
     return static_cast<unsigned char>(interp);
 }
 
+// Tabla de n coordenadas de origen i / factor sobre un eje de `limite`
+// píxeles, reservada en la arena de temporales
+ImagenOptimizada::Coeficiente* ImagenOptimizada::coeficientesEscala(int n, int limite, float factor) {
+    Coeficiente* tabla = temporales.reservarArray<Coeficiente>(n);
+    if (!tabla) return nullptr;
+    for (int i = 0; i < n; ++i) {
+        float s = i / factor;
+        tabla[i].fuera = s < 0 || s >= limite - 1;
+        tabla[i].i0 = static_cast<int>(s);
+        tabla[i].i1 = std::min(tabla[i].i0 + 1, limite - 1);
+        tabla[i].d = s - tabla[i].i0;
+    }
+    return tabla;
+}
+
+// interpolacion_bilineal con las coordenadas ya resueltas por las tablas
+unsigned char ImagenOptimizada::interpolacion_tabla(const Coeficiente& cx, const Coeficiente& cy,
+                                                    int c) const {
+    if (cx.fuera || cy.fuera) return 0;
+
+    float dx = cx.d;
+    float dy = cy.d;
+    float p00 = pixel(cy.i0, cx.i0, c);
+    float p10 = pixel(cy.i0, cx.i1, c);
+    float p01 = pixel(cy.i1, cx.i0, c);
+    float p11 = pixel(cy.i1, cx.i1, c);
+
+    float interp = p00 * (1 - dx) * (1 - dy) +
+                  p10 * dx * (1 - dy) +
+                  p01 * (1 - dx) * dy +
+                  p11 * dx * dy;
+
+    return static_cast<unsigned char>(interp);
+}
+
 void ImagenOptimizada::rotar(int angulo) {
     if (angulo == 0) return;  // No hacer nada si el ángulo es 0
     
@@ -112,12 +337,37 @@ void ImagenOptimizada::rotar(int angulo) {
     
     // Reservar buffer para la imagen rotada
     size_t tamBuffer = ancho * alto * canales;
-    unsigned char* rotadaBuffer = static_cast<unsigned char*>(allocator->getCache(tamBuffer));
+    unsigned char* rotadaBuffer;
+    {
+        AmbitoEtiqueta etapa(EtiquetaMemoria::RotarSalida);
+        rotadaBuffer = static_cast<unsigned char*>(allocator->getScratch(SCRATCH_IMAGEN, tamBuffer));
+    }
     if (!rotadaBuffer) {
         std::cerr << "Error: No se pudo asignar memoria para la imagen rotada.\n";
         return; // No modificar la imagen si no se puede asignar memoria
     }
     
+    // Productos de la rotación por columna y por fila: cada píxel sólo suma
+    ScratchArena::Ambito ambito(temporales);
+    float* colCos = temporales.reservarArray<float>(ancho);
+    float* colSin = temporales.reservarArray<float>(ancho);
+    float* filaSin = temporales.reservarArray<float>(alto);
+    float* filaCos = temporales.reservarArray<float>(alto);
+    if (!colCos || !colSin || !filaSin || !filaCos) {
+        std::cerr << "Error: No se pudo asignar memoria para las tablas de rotación.\n";
+        return;
+    }
+    for (int x = 0; x < ancho; ++x) {
+        float xr = x - cx;
+        colCos[x] = xr * cosA;
+        colSin[x] = xr * sinA;
+    }
+    for (int y = 0; y < alto; ++y) {
+        float yr = y - cy;
+        filaSin[y] = yr * sinA;
+        filaCos[y] = yr * cosA;
+    }
+    
     // Inicializar buffer con negro
     std::memset(rotadaBuffer, 0, tamBuffer);
     
@@ -125,13 +375,9 @@ void ImagenOptimizada::rotar(int angulo) {
     #pragma omp parallel for collapse(2)
     for (int y = 0; y < alto; ++y) {
         for (int x = 0; x < ancho; ++x) {
-            // Coordenadas relativas al centro
-            float xr = x - cx;
-            float yr = y - cy;
-            
-            // Aplicar la rotación
-            float xp = xr * cosA - yr * sinA + cx;
-            float yp = xr * sinA + yr * cosA + cy;
+            // Aplicar la rotación respecto al centro
+            float xp = colCos[x] - filaSin[y] + cx;
+            float yp = colSin[x] + filaCos[y] + cy;
             
             // Copiar los valores de color usando interpolación bilineal
             for (int c = 0; c < canales; ++c) {
@@ -141,9 +387,9 @@ void ImagenOptimizada::rotar(int angulo) {
         }
     }
     
-    // Intercambiar los buffers
-    std::swap(buffer, rotadaBuffer);
-    allocator->releaseCache();
+    // Intercambiar los buffers: el original queda como buffer de trabajo
+    allocator->intercambiarScratch(SCRATCH_IMAGEN, buffer);
+    buffer = rotadaBuffer;
     
     std::cout << "Rotación completada.\n";
 }
@@ -167,8 +413,43 @@ void ImagenOptimizada::escalar(float factor) {
         return;
     }
     
+    // Coordenadas de origen de cada columna y fila del destino
+    ScratchArena::Ambito ambito(temporales);
+    Coeficiente* columnas = coeficientesEscala(nuevoAncho, ancho, factor);
+    Coeficiente* filas = coeficientesEscala(nuevoAlto, alto, factor);
+    if (!columnas || !filas) {
+        std::cerr << "Error: No se pudo asignar memoria para las tablas de escalado.\n";
+        return;
+    }
+
+    // Reducción en el mismo buffer: el píxel (x, y) del destino se interpola
+    // desde (x/f, y/f) >= (x, y) del origen, así que recorriendo por filas en
+    // orden (secuencial, sin OpenMP) nunca se pisa un píxel que aún haga
+    // falta. Después realloc devuelve la cola al pool sin mover los datos y
+    // el pico de memoria no llega a duplicarse.
+    if (factor < 1.0f) {
+        for (int y = 0; y < nuevoAlto; ++y) {
+            for (int x = 0; x < nuevoAncho; ++x) {
+                for (int c = 0; c < canales; ++c) {
+                    buffer[(y * nuevoAncho + x) * canales + c] = interpolacion_tabla(columnas[x], filas[y], c);
+                }
+            }
+        }
+        unsigned char* reducido = static_cast<unsigned char*>(allocator->realloc(buffer, tamBuffer));
+        if (reducido) buffer = reducido;
+        ancho = nuevoAncho;
+        alto = nuevoAlto;
+
+        std::cout << "Escalado completado.\n";
+        return;
+    }
+
     // Reservar buffer para la imagen escalada
-    unsigned char* escaladaBuffer = static_cast<unsigned char*>(allocator->alloc(tamBuffer));
+    unsigned char* escaladaBuffer;
+    {
+        AmbitoEtiqueta etapa(EtiquetaMemoria::EscalarSalida);
+        escaladaBuffer = static_cast<unsigned char*>(allocator->getScratch(SCRATCH_IMAGEN, tamBuffer));
+    }
     if (!escaladaBuffer) {
         std::cerr << "Error: No se pudo asignar memoria para la imagen escalada.\n";
         return; // No modificar la imagen si no se puede asignar memoria
@@ -181,50 +462,111 @@ void ImagenOptimizada::escalar(float factor) {
     #pragma omp parallel for collapse(2)
     for (int y = 0; y < nuevoAlto; ++y) {
         for (int x = 0; x < nuevoAncho; ++x) {
-            // Mapear coordenadas
-            float srcX = x / factor;
-            float srcY = y / factor;
-            
             // Copiar los valores de color usando interpolación bilineal
             for (int c = 0; c < canales; ++c) {
-                escaladaBuffer[(y * nuevoAncho + x) * canales + c] = interpolacion_bilineal(srcX, srcY, c);
+                escaladaBuffer[(y * nuevoAncho + x) * canales + c] = interpolacion_tabla(columnas[x], filas[y], c);
             }
         }
     }
     
-    // Actualizar los atributos de la imagen
-    void* oldBuffer = buffer;
+    // Actualizar los atributos de la imagen; el buffer antiguo queda como
+    // buffer de trabajo para la siguiente operación
+    allocator->intercambiarScratch(SCRATCH_IMAGEN, buffer);
     buffer = escaladaBuffer;
     ancho = nuevoAncho;
     alto = nuevoAlto;
     
-    // Liberar buffer antiguo
-    if (oldBuffer) {
-        allocator->free(oldBuffer);
-    }
-    
     std::cout << "Escalado completado.\n";
 }
 
 // Implementaciones de las funciones wrapper
-ImagenOptimizada* cargar_imagen_buddy_opt(const std::string& ruta) {
-    return new ImagenOptimizada(ruta, &globalAllocator);
+void preparar_pool_buddy_opt(const std::string& ruta, EstrategiaPool estrategia, PrecargaPool precarga) {
+    poolGlobal(ruta, estrategia, precarga);
+}
+
+void abrir_cache_buddy_opt(const std::string& archivo) {
+    BuddyOpciones opciones;
+    opciones.compuestos = true;
+    opciones.archivoPersistente = archivo;
+    cacheImagenes.reset(new BuddyAllocator(TAM_CACHE, opciones));
+}
+
+ImagenOptimizada* cargar_imagen_buddy_opt(const std::string& ruta, bool usarCache) {
+    return new ImagenOptimizada(ruta, nullptr, usarCache ? cacheImagenes.get() : nullptr);
 }
 
 void procesar_imagen_buddy_opt(ImagenOptimizada* img) {
-    std::cout << "Imagen cargada (Buddy System Optimizado):" << std::endl;
+    std::cout << "Imagen cargada (" << etiquetaPool() << "):" << std::endl;
     img->mostrarInfo();
 }
 
 void rotar_imagen_buddy_opt(ImagenOptimizada* img, int angulo, const std::string& salida) {
     img->rotar(angulo);
     img->guardarImagen(salida);
-    std::cout << "Imagen rotada (Buddy Optimizado) guardada en: " << salida << std::endl;
+    std::cout << "Imagen rotada (" << etiquetaPool() << ") guardada en: " << salida << std::endl;
 }
 
 void escalar_imagen_buddy_opt(ImagenOptimizada* img, float factor, const std::string& salida) {
     img->escalar(factor);
     img->guardarImagen(salida);
-    std::cout << "Imagen escalada (Buddy Optimizado) guardada en: " << salida << std::endl;
+    std::cout << "Imagen escalada (" << etiquetaPool() << ") guardada en: " << salida << std::endl;
     std::cout << "Nuevo tamaño: " << img->getAncho() << " x " << img->getAlto() << std::endl;
-}
\ No newline at end of file
+}
+
+void mostrar_estado_buddy_opt() {
+    poolGlobal().printStatus();
+    std::cout << "[STATS] " << poolGlobal().estadisticasJson() << std::endl;
+}
+
+// Bytes por etiqueta al terminar de procesar, antes de liberar la imagen
+// (después todo vuelve al pool y la columna saldría siempre a cero)
+static size_t bytesEtapaAlTerminar[BuddyEstadisticas::NUM_ETIQUETAS];
+
+void capturar_memoria_etapas_buddy_opt() {
+    BuddyAllocator* buddy = dynamic_cast<BuddyAllocator*>(&poolGlobal());
+    if (!buddy) return;
+    BuddyEstadisticas e = buddy->getStats();
+    std::copy(e.bytesPorEtiqueta, e.bytesPorEtiqueta + BuddyEstadisticas::NUM_ETIQUETAS,
+              bytesEtapaAlTerminar);
+}
+
+// Tabla de bytes por etiqueta del sitio de reserva (sólo la lleva el pool
+// buddy; false si el pool es otro y no se imprimió nada). Un buffer de
+// trabajo reutilizado conserva la etiqueta de la etapa que lo reservó
+bool mostrar_memoria_etapas_buddy_opt() {
+    BuddyAllocator* buddy = dynamic_cast<BuddyAllocator*>(&poolGlobal());
+    if (!buddy) return false;
+    BuddyEstadisticas e = buddy->getStats();
+    const double MB = 1024.0 * 1024.0;
+    std::cout << "MEMORIA POR ETAPA (MB, al terminar / pico):\n";
+    std::cout << std::fixed << std::setprecision(2);
+    for (int i = 0; i < BuddyEstadisticas::NUM_ETIQUETAS; ++i) {
+        std::cout << " - " << std::left << std::setw(16) << nombreEtiqueta(static_cast<EtiquetaMemoria>(i))
+                  << std::right << std::setw(10) << bytesEtapaAlTerminar[i] / MB << std::setw(10)
+                  << e.picoPorEtiqueta[i] / MB << "\n";
+    }
+    std::cout << std::defaultfloat << std::setprecision(6);
+    return true;
+}
+
+// Al terminar un trabajo: los buffers de trabajo vuelven al pool y trim
+// devuelve al sistema las páginas de los bloques libres grandes, para que el
+// RSS del proceso no se quede en el pico de la imagen más grande
+size_t devolver_memoria_buddy_opt() {
+    poolGlobal().liberarScratch();
+    return poolGlobal().trim();
+}
+
+// La traza es del BuddyAllocator (buddy_traza.h)
+bool iniciar_traza_buddy_opt(const std::string& ruta) {
+    BuddyAllocator* buddy = dynamic_cast<BuddyAllocator*>(&poolGlobal());
+    if (!buddy) {
+        std::cerr << "Error: la traza sólo está disponible con el pool buddy\n";
+        return false;
+    }
+    return buddy->iniciarTraza(ruta.c_str());
+}
+
+void detener_traza_buddy_opt() {
+    if (BuddyAllocator* buddy = dynamic_cast<BuddyAllocator*>(&poolGlobal())) buddy->detenerTraza();
+}
@@ -3,11 +3,17 @@
 
 #include "../buddy_system/imagen.h"
 #include "buddy_allocator.h"
+#include "image_allocator.h"
+#include "scratch_arena.h"
 #include <string>
 
 class ImagenOptimizada {
 public:
-    ImagenOptimizada(const std::string& ruta, BuddyAllocator* allocator = nullptr);
+    // Con cache (pool persistente, ver abrir_cache_buddy_opt) la imagen se
+    // copia desde ella si ya se decodificó, aquí o en una ejecución anterior,
+    // y si no se decodifica y se guarda en ella
+    ImagenOptimizada(const std::string& ruta, ImageAllocator* allocator = nullptr,
+                     BuddyAllocator* cache = nullptr);
     ~ImagenOptimizada();
     
     void guardarImagen(const std::string& ruta) const;
@@ -26,7 +32,8 @@ private:
     int alto;
     int canales;
     unsigned char* buffer;  // Buffer lineal en lugar de matriz 3D
-    BuddyAllocator* allocator;
+    ImageAllocator* allocator;
+    ScratchArena temporales;  // Tablas de coeficientes de rotar/escalar
     
     // Métodos de acceso optimizados
     inline unsigned char& pixel(int y, int x, int c) {
@@ -37,14 +44,52 @@ private:
         return buffer[(y * ancho + x) * canales + c];
     }
     
+    void decodificar(const std::string& ruta);
+    bool leerDeCache(BuddyAllocator& cache, const std::string& clave);
+    void guardarEnCache(BuddyAllocator& cache, const std::string& clave) const;
+
     // Método para interpolación bilineal optimizada
     unsigned char interpolacion_bilineal(float x, float y, int c) const;
+
+    // Coordenada de origen precalculada para una columna o fila del destino:
+    // vecinos, peso del segundo y si cae en el borde (negro)
+    struct Coeficiente {
+        int i0;
+        int i1;
+        float d;
+        bool fuera;
+    };
+    Coeficiente* coeficientesEscala(int n, int limite, float factor);
+    unsigned char interpolacion_tabla(const Coeficiente& cx, const Coeficiente& cy, int c) const;
+};
+
+// Estrategia de memoria del pool global (-alloc en main)
+enum class EstrategiaPool {
+    Buddy,   // BuddyAllocator
+    Tlsf,    // TlsfAllocator
+    Malloc   // MallocAllocator: el heap del proceso, como línea base
 };
 
 // Nuevas funciones optimizadas
-ImagenOptimizada* cargar_imagen_buddy_opt(const std::string& ruta);
+// Construye el pool global con el tamaño que prevé la cabecera de la imagen
+// (si no, se construye como buddy al cargar la primera). Con precarga (sólo
+// buddy), los fallos de página del pool se pagan aquí y no al procesar la imagen.
+void preparar_pool_buddy_opt(const std::string& ruta,
+                             EstrategiaPool estrategia = EstrategiaPool::Buddy,
+                             PrecargaPool precarga = PrecargaPool::Ninguna);
+// Caché de imágenes decodificadas en un pool persistente (fichero mapeado):
+// un proceso que arranca con la caché caliente no vuelve a decodificar
+void abrir_cache_buddy_opt(const std::string& archivo);
+ImagenOptimizada* cargar_imagen_buddy_opt(const std::string& ruta, bool usarCache = false);
 void procesar_imagen_buddy_opt(ImagenOptimizada* img);
 void rotar_imagen_buddy_opt(ImagenOptimizada* img, int angulo, const std::string& salida);
 void escalar_imagen_buddy_opt(ImagenOptimizada* img, float factor, const std::string& salida);
+void mostrar_estado_buddy_opt();
+// Capturar antes de liberar la imagen; mostrar devuelve false si el pool no es buddy
+void capturar_memoria_etapas_buddy_opt();
+bool mostrar_memoria_etapas_buddy_opt();
+size_t devolver_memoria_buddy_opt();
+bool iniciar_traza_buddy_opt(const std::string& ruta);
+void detener_traza_buddy_opt();
 
 #endif // BUDDY_IMG_PROCESSOR_OPTIMIZED_H
\ No newline at end of file
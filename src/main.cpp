@@ -6,6 +6,8 @@
 #include <chrono>
 #include <sys/resource.h>
 #include <cstdio>
+#include <iomanip>
+#include <vector>
 #include "../buddy_system/stb_image.h"
 
 long memoria_actual_kb() {
@@ -18,9 +20,30 @@ long tiempo_ms(std::chrono::steady_clock::time_point ini, std::chrono::steady_cl
     return std::chrono::duration_cast<std::chrono::milliseconds>(fin - ini).count();
 }
 
+// Tiempo y fallos de página (menores: el núcleo asigna y rellena de ceros
+// una página; mayores: hay que leerla de disco) de cada etapa
+struct Etapa {
+    std::string nombre;
+    long ms;
+    long fallosMenores;
+    long fallosMayores;
+};
+
+template <typename F>
+void medir_etapa(std::vector<Etapa>& etapas, const std::string& nombre, F&& f) {
+    struct rusage antes, despues;
+    getrusage(RUSAGE_SELF, &antes);
+    auto ini = std::chrono::steady_clock::now();
+    f();
+    auto fin = std::chrono::steady_clock::now();
+    getrusage(RUSAGE_SELF, &despues);
+    etapas.push_back({nombre, tiempo_ms(ini, fin), despues.ru_minflt - antes.ru_minflt,
+                      despues.ru_majflt - antes.ru_majflt});
+}
+
 int main(int argc, char* argv[]) {
     if (argc < 2) {
-        std::cerr << "Uso: " << argv[0] << " <entrada.jpg> [salida.jpg] [-angulo N] [-escalar F] [-buddy]" << std::endl;
+        std::cerr << "Uso: " << argv[0] << " <entrada.jpg> [salida.jpg] [-angulo N] [-escalar F] [-buddy | -alloc buddy|tlsf|malloc] [-stats] [-traza archivo] [-precarga populate|paralela] [-cache archivo]" << std::endl;
         return 1;
     }
 
@@ -31,12 +54,49 @@ int main(int argc, char* argv[]) {
     bool tieneSalida = false;
     bool tieneAngulo = false;
     bool tieneEscala = false;
-    bool usarBuddy = false;
+    bool usarBuddy = false;   // Pool propio (cualquier estrategia) en lugar de new/delete
+    EstrategiaPool estrategia = EstrategiaPool::Buddy;
+    std::string nombrePool = "buddy";
+    bool mostrarStats = false;
+    std::string rutaTraza = "";
+    PrecargaPool precarga = PrecargaPool::Ninguna;
+    std::string rutaCache = "";
+    std::vector<Etapa> etapas;
 
     for (int i = 2; i < argc; ++i) {
         std::string arg = argv[i];
         if (arg == "-buddy") {
             usarBuddy = true;
+        } else if (arg == "-alloc" && i + 1 < argc) {
+            nombrePool = argv[++i];
+            if (nombrePool == "buddy") {
+                estrategia = EstrategiaPool::Buddy;
+            } else if (nombrePool == "tlsf") {
+                estrategia = EstrategiaPool::Tlsf;
+            } else if (nombrePool == "malloc") {
+                estrategia = EstrategiaPool::Malloc;
+            } else {
+                std::cerr << "Error: allocator desconocido '" << nombrePool << "' (buddy, tlsf o malloc)" << std::endl;
+                return 1;
+            }
+            usarBuddy = true;
+        } else if (arg == "-stats") {
+            mostrarStats = true;
+        } else if (arg == "-traza" && i + 1 < argc) {
+            rutaTraza = argv[++i];
+        } else if (arg == "-precarga" && i + 1 < argc) {
+            std::string modo = argv[++i];
+            if (modo == "populate") {
+                precarga = PrecargaPool::MapPopulate;
+            } else if (modo == "paralela") {
+                precarga = PrecargaPool::Paralela;
+            } else {
+                std::cerr << "Error: precarga desconocida '" << modo << "' (populate o paralela)" << std::endl;
+                return 1;
+            }
+        } else if (arg == "-cache" && i + 1 < argc) {
+            rutaCache = argv[++i];
+            usarBuddy = true;
         } else if (arg == "-angulo" && i + 1 < argc) {
             angulo = std::stoi(argv[++i]);
             tieneAngulo = true;
@@ -79,6 +139,9 @@ int main(int argc, char* argv[]) {
         return 1;
     }
 
+    // Nombre del modo en los informes; con el buddy se mantiene el de siempre
+    std::string etiquetaModo = estrategia == EstrategiaPool::Buddy ? "Buddy System" : "allocator " + nombrePool;
+
     bool fueRotada = false;
     bool fueEscalada = false;
     int ancho = 0, alto = 0, canales = 0;
@@ -88,51 +151,78 @@ int main(int argc, char* argv[]) {
     std::cout << "\n=== PROCESAMIENTO DE IMAGEN ===\n";
     std::cout << "Archivo de entrada: " << entrada << "\n";
     std::cout << "Archivo de salida: " << salida << "\n";
-    std::cout << "Modo de asignación de memoria: " << (usarBuddy ? "Buddy System Optimizado" : "Convencional") << "\n";
+    std::cout << "Modo de asignación de memoria: " << (usarBuddy ? (estrategia == EstrategiaPool::Buddy ? "Buddy System Optimizado" : etiquetaModo) : "Convencional") << "\n";
     std::cout << "------------------------\n";
 
+    // El pool se prepara fuera de la región cronometrada, como haría un
+    // trabajador al arrancar; con -precarga sus fallos de página caen aquí
+    if (usarBuddy) {
+        medir_etapa(etapas, "pool", [&] { preparar_pool_buddy_opt(entrada, estrategia, precarga); });
+    }
+    // Adjuntarse a la caché persistente también es trabajo de arranque
+    if (!rutaCache.empty()) {
+        medir_etapa(etapas, "cache", [&] { abrir_cache_buddy_opt(rutaCache); });
+    }
+
     auto t0 = std::chrono::steady_clock::now();
     long mem0 = memoria_actual_kb();
 
     if (usarBuddy) {
-        ImagenOptimizada* img = cargar_imagen_buddy_opt(entrada);
+        if (!rutaTraza.empty() && !iniciar_traza_buddy_opt(rutaTraza)) return 1;
+
+        ImagenOptimizada* img = nullptr;
+        medir_etapa(etapas, "carga", [&] { img = cargar_imagen_buddy_opt(entrada, !rutaCache.empty()); });
         if (!img) return 1;
 
         if (tieneAngulo) {
-            rotar_imagen_buddy_opt(img, angulo, tieneEscala ? "__tmp_rotada.jpg" : salida);
+            medir_etapa(etapas, "rotar", [&] {
+                rotar_imagen_buddy_opt(img, angulo, tieneEscala ? "__tmp_rotada.jpg" : salida);
+            });
             fueRotada = true;
         }
         
         if (tieneEscala) {
             if (tieneAngulo) {
                 // Cargar la imagen rotada
-                delete img;
-                img = cargar_imagen_buddy_opt("__tmp_rotada.jpg");
+                medir_etapa(etapas, "recarga", [&] {
+                    delete img;
+                    img = cargar_imagen_buddy_opt("__tmp_rotada.jpg");
+                });
             }
-            escalar_imagen_buddy_opt(img, factorEscala, salida);
+            medir_etapa(etapas, "escalar", [&] { escalar_imagen_buddy_opt(img, factorEscala, salida); });
             fueEscalada = true;
         }
 
         ancho = img->getAncho();
         alto = img->getAlto();
         canales = img->getCanales();
+        capturar_memoria_etapas_buddy_opt();
         
-        delete img;
+        medir_etapa(etapas, "liberar", [&] {
+            delete img;
+            devolver_memoria_buddy_opt();
+        });
+        if (!rutaTraza.empty()) detener_traza_buddy_opt();
     } else {
-        ConvImagen* img = cargar_imagen_conv(entrada);
+        ConvImagen* img = nullptr;
+        medir_etapa(etapas, "carga", [&] { img = cargar_imagen_conv(entrada); });
         if (!img) return 1;
 
         if (tieneAngulo) {
-            rotar_imagen_conv(img, angulo, tieneEscala ? "__tmp_rotada.jpg" : salida);
+            medir_etapa(etapas, "rotar", [&] {
+                rotar_imagen_conv(img, angulo, tieneEscala ? "__tmp_rotada.jpg" : salida);
+            });
             fueRotada = true;
         }
         
         if (tieneEscala) {
             if (tieneAngulo) {
-                liberar_imagen_conv(img);
-                img = cargar_imagen_conv("__tmp_rotada.jpg");
+                medir_etapa(etapas, "recarga", [&] {
+                    liberar_imagen_conv(img);
+                    img = cargar_imagen_conv("__tmp_rotada.jpg");
+                });
             }
-            escalar_imagen_conv(img, factorEscala, salida);
+            medir_etapa(etapas, "escalar", [&] { escalar_imagen_conv(img, factorEscala, salida); });
             fueEscalada = true;
         }
 
@@ -140,7 +230,7 @@ int main(int argc, char* argv[]) {
         alto = img->alto;
         canales = img->canales;
         
-        liberar_imagen_conv(img);
+        medir_etapa(etapas, "liberar", [&] { liberar_imagen_conv(img); });
     }
 
     auto t1 = std::chrono::steady_clock::now();
@@ -164,11 +254,25 @@ int main(int argc, char* argv[]) {
 
     std::cout << "------------------------\n";
     std::cout << "TIEMPO DE PROCESAMIENTO:\n";
-    std::cout << " - " << (usarBuddy ? "Con" : "Sin") << " Buddy System: " << tiempo << " ms\n\n";
+    std::cout << " - " << (usarBuddy ? "Con" : "Sin") << " " << etiquetaModo << ": " << tiempo << " ms\n\n";
 
     std::cout << "MEMORIA UTILIZADA:\n";
-    std::cout << " - " << (usarBuddy ? "Con" : "Sin") << " Buddy System: " << (memoria / 1024.0f) << " MB\n";
+    std::cout << " - " << (usarBuddy ? "Con" : "Sin") << " " << etiquetaModo << ": " << (memoria / 1024.0f) << " MB\n";
     std::cout << "------------------------\n";
+    std::cout << "ETAPAS (ms, fallos de página menores / mayores):\n";
+    for (const Etapa& e : etapas) {
+        std::cout << " - " << std::left << std::setw(8) << e.nombre << std::right
+                  << std::setw(8) << e.ms << " ms" << std::setw(10) << e.fallosMenores
+                  << std::setw(6) << e.fallosMayores << "\n";
+    }
+    std::cout << "------------------------\n";
+    if (usarBuddy && mostrar_memoria_etapas_buddy_opt()) {
+        std::cout << "------------------------\n";
+    }
+    if (usarBuddy && mostrarStats) {
+        mostrar_estado_buddy_opt();
+        std::cout << "------------------------\n";
+    }
     std::cout << "[INFO] Imagen guardada correctamente en " << salida << "\n";
 
     std::remove("__tmp_rotada.jpg");